@@ -9,6 +9,11 @@ public class MortalCry : ModuleRules
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
 		PublicDependencyModuleNames.AddRange(new string[]
-			{ "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay", "MindMaker", "SocketIOClient" });
+			{ "Core", "CoreUObject", "Engine", "NetCore", "InputCore", "Projects", "UMG", "HeadMountedDisplay", "MindMaker", "SocketIOClient" });
+
+		if (Target.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.Add("UnrealEd");
+		}
 	}
 }
@@ -3,15 +3,157 @@
 
 #include "Character/HealthComponent.h"
 
+#include "Net/UnrealNetwork.h"
+#include "Perception/AISense_Damage.h"
+
 UHealthComponent::UHealthComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	// after the weapons fired this frame
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	SetIsReplicatedByDefault(true);
+
 	MaxHealth = Health = 1000.f;
+	OwnerHealth = MAX_uint16;
+	ProxyHealth = MAX_uint8;
+	PendingHealthChange = 0.f;
+}
+
+void UHealthComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// a configured starting health below the maximum replicates from the start, not from the first hit
+	if ( GetOwnerRole() == ROLE_Authority )
+	{
+		SetHealth(Health);
+	}
+}
+
+void UHealthComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME_CONDITION(UHealthComponent, OwnerHealth, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(UHealthComponent, ProxyHealth, COND_SkipOwner);
+}
+
+void UHealthComponent::OnRep_OwnerHealth()
+{
+	const float OldHealth = Health;
+	Health = MaxHealth * OwnerHealth / MAX_uint16;
+	OnHealthChanged.Broadcast(GetHealth(), Health - OldHealth);
+}
+
+void UHealthComponent::OnRep_ProxyHealth()
+{
+	const float OldHealth = Health;
+	Health = MaxHealth * ProxyHealth / MAX_uint8;
+	OnHealthChanged.Broadcast(GetHealth(), Health - OldHealth);
+}
+
+void UHealthComponent::SetHealth(float NewHealth)
+{
+	const float HealthChange = ApplyHealth(NewHealth);
+	if ( HealthChange != 0.f )
+	{
+		OnHealthChanged.Broadcast(GetHealth(), HealthChange);
+	}
+}
+
+float UHealthComponent::ApplyHealth(float NewHealth)
+{
+	const float OldHealth = Health;
+	Health = FMath::Clamp(NewHealth, 0.f, MaxHealth);
+
+	// round up so only zero health replicates as dead
+	const float Fraction = GetHealth();
+	OwnerHealth = static_cast<uint16>(FMath::CeilToInt(Fraction * MAX_uint16));
+	ProxyHealth = static_cast<uint8>(FMath::CeilToInt(Fraction * MAX_uint8));
+
+	return Health - OldHealth;
 }
 
 void UHealthComponent::Update(float HealthChange)
 {
-	Health += HealthChange;
-	Health = FMath::Clamp(Health, 0.f, MaxHealth);
+	SetHealth(Health + HealthChange);
+}
+
+void UHealthComponent::QueueDamage(float Damage, AController* EventInstigator, const FVector& Origin, const FVector& Location)
+{
+	if ( Damage <= 0.f )
+	{
+		return;
+	}
+
+	FPendingDamage* Pending = PendingDamage.FindByPredicate([EventInstigator](const FPendingDamage& Entry)
+	{
+		return Entry.Instigator == EventInstigator;
+	});
+
+	if ( !Pending )
+	{
+		Pending = &PendingDamage.AddDefaulted_GetRef();
+		Pending->Instigator = EventInstigator;
+		Pending->Damage = 0.f;
+		Pending->StrongestHit = -1.f;
+	}
+
+	Pending->Damage += Damage;
+	if ( Damage > Pending->StrongestHit )
+	{
+		Pending->StrongestHit = Damage;
+		Pending->Origin = Origin;
+		Pending->Location = Location;
+	}
+
+	// health and death are current for the rest of the frame, only the notifications wait
+	PendingHealthChange += ApplyHealth(Health - Damage);
+
+	SetComponentTickEnabled(true);
+}
+
+void UHealthComponent::FlushPendingDamage()
+{
+	if ( PendingDamage.Num() == 0 )
+	{
+		return;
+	}
+
+	if ( PendingHealthChange != 0.f )
+	{
+		const float HealthChange = PendingHealthChange;
+		PendingHealthChange = 0.f;
+		OnHealthChanged.Broadcast(GetHealth(), HealthChange);
+	}
+
+	// one report per instigator, so perception still knows everyone who shot at us
+	if ( AActor* Owner = GetOwner() )
+	{
+		for (const FPendingDamage& Pending : PendingDamage)
+		{
+			UAISense_Damage::ReportDamageEvent(GetWorld(), Owner, Pending.Instigator.Get(), Pending.Damage, Pending.Origin, Pending.Location);
+		}
+	}
+
+	PendingDamage.Reset();
+}
+
+void UHealthComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	FlushPendingDamage();
+	SetComponentTickEnabled(false);
+}
+
+void UHealthComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FlushPendingDamage();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 float UHealthComponent::GetHealth() const
@@ -23,4 +165,3 @@ bool UHealthComponent::IsAlive() const
 {
 	return Health > 0.f;
 }
-
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/HitboxHistoryComponent.h"
+
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/GameStateBase.h"
+
+void FHitboxHistory::Reset()
+{
+	Head = 0;
+	Num = 0;
+}
+
+void FHitboxHistory::Record(float Time, const FVector& Center, const FVector& Extent)
+{
+	Times[Head] = Time;
+	Centers[Head] = Center;
+	Extents[Head] = Extent;
+
+	Head = (Head + 1) % Capacity;
+	Num = FMath::Min(Num + 1, Capacity);
+}
+
+bool FHitboxHistory::GetBoxAt(float Time, FBox& OutBox) const
+{
+	if ( Num == 0 )
+	{
+		return false;
+	}
+
+	// walk from the newest sample back until we pass the requested time
+	int32 Newer = (Head + Capacity - 1) % Capacity;
+	for (int32 Step = 1; Step < Num; ++Step)
+	{
+		const int32 Older = (Newer + Capacity - 1) % Capacity;
+		if ( Times[Older] <= Time )
+		{
+			const float Span = Times[Newer] - Times[Older];
+			const float Alpha = Span > KINDA_SMALL_NUMBER ? FMath::Clamp((Time - Times[Older]) / Span, 0.f, 1.f) : 1.f;
+
+			const FVector Center = FMath::Lerp(Centers[Older], Centers[Newer], Alpha);
+			const FVector Extent = FMath::Lerp(Extents[Older], Extents[Newer], Alpha);
+			OutBox = FBox(Center - Extent, Center + Extent);
+			return true;
+		}
+		Newer = Older;
+	}
+
+	// older than anything we kept, use the oldest pose
+	OutBox = FBox(Centers[Newer] - Extents[Newer], Centers[Newer] + Extents[Newer]);
+	return true;
+}
+
+UHitboxHistoryComponent::UHitboxHistoryComponent(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	// one way latency of a 300ms ping, the hit notify batching delay and client interpolation
+	MaxRewindTime = 0.5f;
+}
+
+void UHitboxHistoryComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// only the server verifies hits
+	SetComponentTickEnabled(GetOwnerRole() == ROLE_Authority);
+}
+
+void UHitboxHistoryComponent::TickComponent(float DeltaTime, ELevelTick TickType,
+	FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if ( !Character || !Character->GetCapsuleComponent() )
+	{
+		return;
+	}
+
+	const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	const float Radius = Capsule->GetScaledCapsuleRadius();
+	const FVector Extent(Radius, Radius, Capsule->GetScaledCapsuleHalfHeight());
+
+	History.Record(GetTimestamp(GetWorld()), Capsule->GetComponentLocation(), Extent);
+}
+
+float UHitboxHistoryComponent::GetTimestamp(const UWorld* World)
+{
+	if ( !World )
+	{
+		return 0.f;
+	}
+
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+bool UHitboxHistoryComponent::GetHitboxAt(float Timestamp, FBox& OutBox) const
+{
+	const float Now = GetTimestamp(GetWorld());
+	return History.GetBoxAt(FMath::Clamp(Timestamp, Now - MaxRewindTime, Now), OutBox);
+}
+
+bool UHitboxHistoryComponent::VerifyHit(float Timestamp, const FVector& ShotStart, const FVector& ShotDir, float ShotRange,
+	const FVector& ImpactLocation, float Leeway) const
+{
+	FBox HitBox;
+	if ( !GetHitboxAt(Timestamp, HitBox) )
+	{
+		return false;
+	}
+
+	HitBox = HitBox.ExpandBy(Leeway);
+
+	// the impact has to sit on the rewound box and the shot the server regenerated has to pass through it,
+	// the client's impact point alone always reaches a box it lies in
+	const FVector ShotDelta = ShotDir * ShotRange;
+	return HitBox.IsInside(ImpactLocation) && FMath::LineBoxIntersection(HitBox, ShotStart, ShotStart + ShotDelta, ShotDelta);
+}
@@ -2,8 +2,11 @@
 
 #include "Character/MortalCryCharacter.h"
 
+#include "MortalCry.h"
+#include "GameplayInterfaceCache.h"
 #include "Inventory/Collectable.h"
 #include "Interactive.h"
+#include "UI/Informative.h"
 #include "Character/MortalCryMovementComponent.h"
 #include "Player/MortalCryPlayerController.h"
 #include "MotionControllerComponent.h"
@@ -16,7 +19,6 @@
 #include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/InputSettings.h"
 #include "Kismet/GameplayStatics.h"
-#include "Perception/AISense_Damage.h"
 #include "Weapon/WeaponBase.h"
 
 // #include "../Plugins/Online/OnlineSubsystemSteam/Source/Public/OnlineSubsystemSteam.h"
@@ -51,6 +53,7 @@ AMortalCryCharacter::AMortalCryCharacter(const FObjectInitializer& ObjectInitial
 	MeshFP->SetOnlyOwnerSee(true);
 
 	Health = CreateDefaultSubobject<UHealthComponent>(TEXT("Health"));
+	HitboxHistory = CreateDefaultSubobject<UHitboxHistoryComponent>(TEXT("HitboxHistory"));
 	Inventory = CreateDefaultSubobject<UInventoryComponent>(TEXT("Inventory"));
 	
 	// Default offset from the character location for projectiles to spawn
@@ -59,6 +62,14 @@ AMortalCryCharacter::AMortalCryCharacter(const FObjectInitializer& ObjectInitial
     bReplicates = true;
 
 	InteractLength = 150.f;
+	InteractTraceInterval = 0.1f;
+	InteractTraceMoveThreshold = 5.f;
+	InteractTraceAngleThreshold = 1.f;
+	CachedInteractStart = FVector::ZeroVector;
+	CachedInteractDirection = FVector::ZeroVector;
+	InvalidateInteractTrace();
+
+	InteractTraceParams = FCollisionQueryParams(SCENE_QUERY_STAT(InteractTrace), false);
 	
 	InventoryOpenDelay = 0.2f;
 }
@@ -160,6 +171,27 @@ void AMortalCryCharacter::SetupPlayerInputComponent(class UInputComponent* Playe
 	}
 }
 
+void AMortalCryCharacter::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if ( IsLocallyControlled() && IsPlayerControlled() )
+	{
+		UpdateInteractFocus();
+	}
+}
+
+void AMortalCryCharacter::UpdateInteractFocus()
+{
+	// a destroyed focus reads as null but still has to be broadcast once
+	AActor* Focus = InteractTrace(UInformative::StaticClass());
+	if ( Focus != InteractFocus.Get() || (!Focus && !InteractFocus.IsExplicitlyNull()) )
+	{
+		InteractFocus = Focus;
+		OnInteractFocusChanged.Broadcast(Focus);
+	}
+}
+
 void AMortalCryCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -205,32 +237,50 @@ void AMortalCryCharacter::OnPickUpItem(AActor* Item)
 
 AActor* AMortalCryCharacter::InteractTrace_Implementation(TSubclassOf<UInterface> SearchClass)
 {
-	FHitResult OutHit;
-	
+	AActor* HitActor = GetInteractTraceHit();
+	if ( HitActor && FGameplayInterfaceCache::Implements(HitActor->GetClass(), SearchClass) )
+	{
+		return HitActor;
+	}
+
+	return nullptr;
+}
+
+AActor* AMortalCryCharacter::GetInteractTraceHit()
+{
 	const FVector Start = GetPawnViewLocation();
 	const FVector Forward = GetControlRotation().Vector();
-	const FVector End = Start + Forward * InteractLength;
 
-	TArray<AActor*> ActorsToIgnore;
-	ActorsToIgnore.Add(this);
-	GetAttachedActors(ActorsToIgnore, false);
+	// the hud and input ask several times a frame, and the answer rarely changes while the view holds still
+	const float Now = GetWorld()->GetTimeSeconds();
+	const bool bSameFrame = LastInteractTraceFrame == GFrameCounter;
+	const bool bViewHeld = Now - LastInteractTraceTime < InteractTraceInterval
+		&& FVector::DistSquared(Start, CachedInteractStart) < FMath::Square(InteractTraceMoveThreshold)
+		&& (Forward | CachedInteractDirection) > FMath::Cos(FMath::DegreesToRadians(InteractTraceAngleThreshold));
 
-	FCollisionQueryParams Params;
-	Params.bTraceComplex = true;
-	Params.AddIgnoredActors(ActorsToIgnore);
-	
-	if (GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, Params))
+	if ( bSameFrame || bViewHeld )
 	{
-		if (OutHit.bBlockingHit && OutHit.GetActor())
-		{
-			if ( OutHit.GetActor()->GetClass()->ImplementsInterface(SearchClass) )
-			{
-				return OutHit.GetActor();
-			}
-		}
+		return CachedInteractHit.Get();
 	}
 
-	return nullptr;
+	LastInteractTraceFrame = GFrameCounter;
+	LastInteractTraceTime = Now;
+	CachedInteractStart = Start;
+	CachedInteractDirection = Forward;
+
+	InteractIgnoredActors.Reset();
+	InteractIgnoredActors.Add(this);
+	GetAttachedActors(InteractIgnoredActors, false);
+
+	InteractTraceParams.ClearIgnoredActors();
+	InteractTraceParams.AddIgnoredActors(InteractIgnoredActors);
+
+	FHitResult OutHit;
+	const FVector End = Start + Forward * InteractLength;
+	GetWorld()->LineTraceSingleByChannel(OutHit, Start, End, ECC_Visibility, InteractTraceParams);
+
+	CachedInteractHit = OutHit.bBlockingHit ? OutHit.GetActor() : nullptr;
+	return CachedInteractHit.Get();
 }
 
 float AMortalCryCharacter::PlayAnimMontage(UAnimMontage* AnimMontage, float InPlayRate, FName StartSectionName)
@@ -320,7 +370,7 @@ void AMortalCryCharacter::StopAlterAction()
 	}
 }
 
-bool AMortalCryCharacter::ServerInteract_Validate(AActor* InInteractiveActor)
+bool AMortalCryCharacter::ServerInteract_Validate(AActor* InInteractiveActor, int32 PredictionId)
 {
 	if ( InInteractiveActor )
 	{
@@ -329,29 +379,44 @@ bool AMortalCryCharacter::ServerInteract_Validate(AActor* InInteractiveActor)
 	return true;
 }
 
-void AMortalCryCharacter::ServerInteract_Implementation(AActor* InInteractiveActor)
+void AMortalCryCharacter::ServerInteract_Implementation(AActor* InInteractiveActor, int32 PredictionId)
 {
 	if ( HasAuthority() )
 	{
 		if ( InInteractiveActor )
 		{
-			if ( InInteractiveActor->Implements<UCollectable>() )
+			if ( FGameplayInterfaceCache::Implements<UCollectable>(InInteractiveActor) )
 			{
 				PickUp(InInteractiveActor);
+
+				// acked whatever the outcome, a pickup that failed here rolls back on the client
+				Inventory->AckPrediction(PredictionId);
 				return;
 			}
 
 			ActualInteractiveActor = InInteractiveActor;
 			IInteractive::Execute_Interact(ActualInteractiveActor, this);
 		}
+
+		Inventory->AckPrediction(PredictionId);
 	}
 }
 
 void AMortalCryCharacter::Interact_Implementation()
 {
+	// acting on what is in view right now, not on the last cached trace
+	InvalidateInteractTrace();
+
 	if ( AActor* Interactive = InteractTrace(UInteractive::StaticClass()) )
 	{
-		ServerInteract(Interactive);
+		// items go into the inventory right away, the server acks or rolls back the pickup
+		int32 PredictionId = 0;
+		if ( FGameplayInterfaceCache::Implements<UCollectable>(Interactive) && !Interactive->IsA<AWeaponBase>() )
+		{
+			PredictionId = Inventory->PredictCollect(Interactive);
+		}
+
+		ServerInteract(Interactive, PredictionId);
 	}
 }
 
@@ -647,17 +712,49 @@ float AMortalCryCharacter::TakeDamage(float Damage, FDamageEvent const& DamageEv
     AActor* DamageCauser)
 {
 	const float ActualDamage = Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
-	Health->Update(-ActualDamage);
-	
-	if (FPointDamageEvent* const PointDamage = (FPointDamageEvent*)&DamageEvent)
+
+	// IsOfType like AActor::TakeDamage, so events derived from the point and radial ones are handled as those
+	if (DamageEvent.IsOfType(FPointDamageEvent::ClassID))
+	{
+		HandlePointDamage(ActualDamage, static_cast<const FPointDamageEvent&>(DamageEvent), EventInstigator);
+	}
+	else if (DamageEvent.IsOfType(FRadialDamageEvent::ClassID))
 	{
-		const FHitResult Hit = PointDamage->HitInfo;
-		UAISense_Damage::ReportDamageEvent(GetWorld(), this, EventInstigator, ActualDamage, Hit.TraceStart, Hit.ImpactPoint);
+		HandleRadialDamage(ActualDamage, static_cast<const FRadialDamageEvent&>(DamageEvent), EventInstigator);
+	}
+	else
+	{
+		HandleGenericDamage(ActualDamage, EventInstigator, DamageCauser);
 	}
 	
 	return ActualDamage;
 }
 
+// health drops at once, the change is broadcast and reported once per instigator at the end of the frame
+void AMortalCryCharacter::HandlePointDamage(float ActualDamage, const FPointDamageEvent& DamageEvent, AController* EventInstigator)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponPointDamage);
+
+	const FHitResult& Hit = DamageEvent.HitInfo;
+	Health->QueueDamage(ActualDamage, EventInstigator, Hit.TraceStart, Hit.ImpactPoint);
+}
+
+void AMortalCryCharacter::HandleRadialDamage(float ActualDamage, const FRadialDamageEvent& DamageEvent, AController* EventInstigator)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponRadialDamage);
+
+	const FVector HitLocation = DamageEvent.ComponentHits.Num() > 0 ? FVector(DamageEvent.ComponentHits[0].ImpactPoint) : GetActorLocation();
+	Health->QueueDamage(ActualDamage, EventInstigator, DamageEvent.Origin, HitLocation);
+}
+
+void AMortalCryCharacter::HandleGenericDamage(float ActualDamage, AController* EventInstigator, AActor* DamageCauser)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponGenericDamage);
+
+	const FVector Origin = DamageCauser ? DamageCauser->GetActorLocation() : GetActorLocation();
+	Health->QueueDamage(ActualDamage, EventInstigator, Origin, GetActorLocation());
+}
+
 void AMortalCryCharacter::SetGenericTeamId(const FGenericTeamId& TeamID)
 {
 	if ( HasAuthority() )
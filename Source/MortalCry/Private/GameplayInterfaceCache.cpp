@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameplayInterfaceCache.h"
+
+#include "Interactive.h"
+#include "Possessive.h"
+#include "Interfaces/IPluginManager.h"
+#include "Inventory/Collectable.h"
+#include "Inventory/Usable.h"
+#include "UI/Informative.h"
+#include "UObject/UObjectGlobals.h"
+#include "Weapon/Weapon.h"
+#include "Weapon/Ranged/RangedWeapon.h"
+
+#if WITH_EDITOR
+#include "Editor.h"
+#include "Misc/CoreDelegates.h"
+#endif
+
+static_assert(static_cast<uint8>(EGameplayInterface::Num) < 32, "the top bit of a mask marks it as built");
+
+TArray<uint32> FGameplayInterfaceCache::Masks;
+uint32 FGameplayInterfaceCache::Version = 0;
+const UClass* FGameplayInterfaceCache::InterfaceClasses[static_cast<uint8>(EGameplayInterface::Num)] = {};
+
+FDelegateHandle FGameplayInterfaceCache::PostGarbageCollectHandle;
+FDelegateHandle FGameplayInterfaceCache::NewPluginMountedHandle;
+FDelegateHandle FGameplayInterfaceCache::ReloadCompleteHandle;
+
+#if WITH_EDITOR
+FDelegateHandle FGameplayInterfaceCache::PostEngineInitHandle;
+FDelegateHandle FGameplayInterfaceCache::BlueprintCompiledHandle;
+
+void FGameplayInterfaceCache::BindEditorDelegates()
+{
+	if ( GEditor )
+	{
+		BlueprintCompiledHandle = GEditor->OnBlueprintCompiled().AddStatic(&FGameplayInterfaceCache::Invalidate);
+	}
+}
+#endif
+
+void FGameplayInterfaceCache::Startup()
+{
+	// same order as EGameplayInterface
+	InterfaceClasses[static_cast<uint8>(EGameplayInterface::Interactive)] = UInteractive::StaticClass();
+	InterfaceClasses[static_cast<uint8>(EGameplayInterface::Collectable)] = UCollectable::StaticClass();
+	InterfaceClasses[static_cast<uint8>(EGameplayInterface::Usable)] = UUsable::StaticClass();
+	InterfaceClasses[static_cast<uint8>(EGameplayInterface::Informative)] = UInformative::StaticClass();
+	InterfaceClasses[static_cast<uint8>(EGameplayInterface::Possessive)] = UPossessive::StaticClass();
+	InterfaceClasses[static_cast<uint8>(EGameplayInterface::Weapon)] = UWeapon::StaticClass();
+	InterfaceClasses[static_cast<uint8>(EGameplayInterface::RangedWeapon)] = URangedWeapon::StaticClass();
+
+	PostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddStatic(&FGameplayInterfaceCache::Invalidate);
+	NewPluginMountedHandle = IPluginManager::Get().OnNewPluginMounted().AddLambda([](IPlugin&) { Invalidate(); });
+	ReloadCompleteHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([](EReloadCompleteReason) { Invalidate(); });
+
+#if WITH_EDITOR
+	if ( GEditor )
+	{
+		BindEditorDelegates();
+	}
+	else
+	{
+		PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddStatic(&FGameplayInterfaceCache::BindEditorDelegates);
+	}
+#endif
+}
+
+void FGameplayInterfaceCache::Shutdown()
+{
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectHandle);
+	IPluginManager::Get().OnNewPluginMounted().Remove(NewPluginMountedHandle);
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(ReloadCompleteHandle);
+
+#if WITH_EDITOR
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+	if ( GEditor )
+	{
+		GEditor->OnBlueprintCompiled().Remove(BlueprintCompiledHandle);
+	}
+#endif
+
+	Invalidate();
+
+	for (const UClass*& InterfaceClass : InterfaceClasses)
+	{
+		InterfaceClass = nullptr;
+	}
+}
+
+uint32 FGameplayInterfaceCache::GetMask(const UClass* Class)
+{
+	check(IsInGameThread());
+
+	if ( !Class )
+	{
+		return 0;
+	}
+
+	const int32 ClassIndex = Class->GetUniqueID();
+	if ( Masks.IsValidIndex(ClassIndex) && (Masks[ClassIndex] & KnownMaskBit) )
+	{
+		return Masks[ClassIndex] & ~KnownMaskBit;
+	}
+
+	uint32 Mask = 0;
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(InterfaceClasses); ++Index)
+	{
+		if ( InterfaceClasses[Index] && Class->ImplementsInterface(InterfaceClasses[Index]) )
+		{
+			Mask |= 1u << Index;
+		}
+	}
+
+	if ( ClassIndex >= Masks.Num() )
+	{
+		Masks.SetNumZeroed(ClassIndex + 1);
+	}
+
+	Masks[ClassIndex] = Mask | KnownMaskBit;
+	return Mask;
+}
+
+uint32 FGameplayInterfaceCache::GetInterfaceMask(const UClass* InterfaceClass)
+{
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(InterfaceClasses); ++Index)
+	{
+		if ( InterfaceClasses[Index] == InterfaceClass )
+		{
+			return 1u << Index;
+		}
+	}
+
+	return 0;
+}
+
+bool FGameplayInterfaceCache::Implements(const UClass* Class, const UClass* InterfaceClass)
+{
+	if ( !Class || !InterfaceClass )
+	{
+		return false;
+	}
+
+	const uint32 InterfaceMask = GetInterfaceMask(InterfaceClass);
+	if ( InterfaceMask == 0 )
+	{
+		return Class->ImplementsInterface(InterfaceClass);
+	}
+
+	return (GetMask(Class) & InterfaceMask) != 0;
+}
+
+void FGameplayInterfaceCache::Invalidate()
+{
+	Masks.Reset();
+	++Version;
+}
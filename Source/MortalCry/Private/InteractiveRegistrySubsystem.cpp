@@ -0,0 +1,469 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "InteractiveRegistrySubsystem.h"
+
+#include "EngineUtils.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "GameplayInterfaceCache.h"
+
+namespace
+{
+	struct FInteractiveCandidate
+	{
+		AActor* Actor;
+		float DistSquared;
+
+		bool operator<(const FInteractiveCandidate& Other) const { return DistSquared < Other.DistSquared; }
+	};
+}
+
+UInteractiveRegistrySubsystem::UInteractiveRegistrySubsystem()
+{
+	bNeedsLevelScan = true;
+	InterfaceMaskVersion = FGameplayInterfaceCache::GetVersion();
+}
+
+void UInteractiveRegistrySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	UWorld* World = GetWorld();
+	ActorSpawnedHandle = World->AddOnActorSpawnedHandler(FOnActorSpawned::FDelegate::CreateUObject(this, &UInteractiveRegistrySubsystem::RegisterActor));
+	LevelAddedHandle = FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UInteractiveRegistrySubsystem::HandleLevelAdded);
+}
+
+void UInteractiveRegistrySubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorSpawnedHandler(ActorSpawnedHandle);
+	FWorldDelegates::LevelAddedToWorld.Remove(LevelAddedHandle);
+
+	for (const TObjectKey<AActor>& Dormant : DormantActors)
+	{
+		if ( AActor* Actor = Dormant.ResolveObjectPtr() )
+		{
+			Actor->OnEndPlay.RemoveDynamic(this, &UInteractiveRegistrySubsystem::HandleActorEndPlay);
+		}
+	}
+	DormantActors.Reset();
+
+	while ( Entries.Num() > 0 )
+	{
+		if ( AActor* Actor = Entries.Last().Actor.ResolveObjectPtr() )
+		{
+			UnregisterActor(Actor);
+		}
+		else
+		{
+			RemoveEntry(Entries.Num() - 1);
+		}
+	}
+
+	Super::Deinitialize();
+}
+
+uint32 UInteractiveRegistrySubsystem::GetIndexedMask()
+{
+	return FGameplayInterfaceCache::GetInterfaceMask(EGameplayInterface::Interactive)
+		| FGameplayInterfaceCache::GetInterfaceMask(EGameplayInterface::Collectable)
+		| FGameplayInterfaceCache::GetInterfaceMask(EGameplayInterface::Usable);
+}
+
+bool UInteractiveRegistrySubsystem::IsHeld(const AActor* Actor)
+{
+	const USceneComponent* Root = Actor->GetRootComponent();
+	return Actor->IsHidden() || (Root && Root->GetAttachParent());
+}
+
+FIntPoint UInteractiveRegistrySubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UInteractiveRegistrySubsystem::RegisterActor(AActor* Actor)
+{
+	if ( !IsValid(Actor) || EntryIndices.Contains(Actor) || DormantActors.Contains(Actor) )
+	{
+		return;
+	}
+
+	const uint32 InterfaceMask = FGameplayInterfaceCache::GetMask(Actor->GetClass()) & GetIndexedMask();
+	if ( InterfaceMask == 0 )
+	{
+		return;
+	}
+
+	if ( IsHeld(Actor) )
+	{
+		DormantActors.Add(Actor);
+		Actor->OnEndPlay.AddUniqueDynamic(this, &UInteractiveRegistrySubsystem::HandleActorEndPlay);
+		return;
+	}
+
+	const int32 EntryIndex = Entries.AddDefaulted();
+	FInteractiveEntry& Entry = Entries[EntryIndex];
+	Entry.Actor = Actor;
+	Entry.Location = Actor->GetActorLocation();
+	Entry.Cell = GetCell(Entry.Location);
+	Entry.InterfaceMask = InterfaceMask;
+
+	EntryIndices.Add(Actor, EntryIndex);
+	Cells.FindOrAdd(Entry.Cell).Add(EntryIndex);
+
+	Actor->OnEndPlay.AddUniqueDynamic(this, &UInteractiveRegistrySubsystem::HandleActorEndPlay);
+	if ( USceneComponent* Root = Actor->GetRootComponent() )
+	{
+		Root->TransformUpdated.AddUObject(this, &UInteractiveRegistrySubsystem::HandleTransformUpdated);
+	}
+}
+
+void UInteractiveRegistrySubsystem::UnregisterActor(AActor* Actor)
+{
+	if ( DormantActors.Remove(Actor) > 0 )
+	{
+		Actor->OnEndPlay.RemoveDynamic(this, &UInteractiveRegistrySubsystem::HandleActorEndPlay);
+		return;
+	}
+
+	int32 EntryIndex = INDEX_NONE;
+	if ( !EntryIndices.RemoveAndCopyValue(Actor, EntryIndex) )
+	{
+		return;
+	}
+
+	Actor->OnEndPlay.RemoveDynamic(this, &UInteractiveRegistrySubsystem::HandleActorEndPlay);
+	if ( USceneComponent* Root = Actor->GetRootComponent() )
+	{
+		Root->TransformUpdated.RemoveAll(this);
+	}
+
+	RemoveEntry(EntryIndex);
+}
+
+void UInteractiveRegistrySubsystem::MakeDormant(AActor* Actor)
+{
+	int32 EntryIndex = INDEX_NONE;
+	if ( !EntryIndices.RemoveAndCopyValue(Actor, EntryIndex) )
+	{
+		return;
+	}
+
+	// still told about end play, but no longer about every move of whoever carries it
+	if ( USceneComponent* Root = Actor->GetRootComponent() )
+	{
+		Root->TransformUpdated.RemoveAll(this);
+	}
+
+	RemoveEntry(EntryIndex);
+	DormantActors.Add(Actor);
+}
+
+void UInteractiveRegistrySubsystem::WakeDormantActors()
+{
+	// nothing announces a drop or an unhide, so the few held items are looked at when someone asks
+	TArray<AActor*, TInlineAllocator<16>> Dropped;
+	for (auto It = DormantActors.CreateIterator(); It; ++It)
+	{
+		AActor* Actor = It->ResolveObjectPtr();
+		if ( !Actor )
+		{
+			It.RemoveCurrent();
+		}
+		else if ( !IsHeld(Actor) )
+		{
+			Dropped.Add(Actor);
+			It.RemoveCurrent();
+		}
+	}
+
+	for (AActor* Actor : Dropped)
+	{
+		RegisterActor(Actor);
+	}
+}
+
+void UInteractiveRegistrySubsystem::RemoveEntry(int32 EntryIndex)
+{
+	const FIntPoint Cell = Entries[EntryIndex].Cell;
+	if ( TArray<int32>* CellEntries = Cells.Find(Cell) )
+	{
+		CellEntries->RemoveSingleSwap(EntryIndex, false);
+		if ( CellEntries->Num() == 0 )
+		{
+			Cells.Remove(Cell);
+		}
+	}
+
+	// the last entry moves into the freed index, its cell and lookup have to follow
+	const int32 LastIndex = Entries.Num() - 1;
+	if ( EntryIndex != LastIndex )
+	{
+		const FInteractiveEntry& Moved = Entries[LastIndex];
+		if ( TArray<int32>* MovedCellEntries = Cells.Find(Moved.Cell) )
+		{
+			MovedCellEntries->Remove(LastIndex);
+			MovedCellEntries->Add(EntryIndex);
+		}
+
+		if ( int32* MovedIndex = EntryIndices.Find(Moved.Actor) )
+		{
+			*MovedIndex = EntryIndex;
+		}
+	}
+
+	Entries.RemoveAtSwap(EntryIndex, 1, false);
+}
+
+void UInteractiveRegistrySubsystem::RegisterLevel(ULevel* Level)
+{
+	for (AActor* Actor : Level->Actors)
+	{
+		RegisterActor(Actor);
+	}
+}
+
+void UInteractiveRegistrySubsystem::ScanLevelsIfNeeded()
+{
+	// actors loaded with the map were never spawned, they are picked up the first time anyone asks
+	if ( !bNeedsLevelScan )
+	{
+		return;
+	}
+
+	bNeedsLevelScan = false;
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		RegisterActor(*It);
+	}
+}
+
+void UInteractiveRegistrySubsystem::RefreshInterfaceMasksIfNeeded()
+{
+	if ( InterfaceMaskVersion == FGameplayInterfaceCache::GetVersion() )
+	{
+		return;
+	}
+
+	InterfaceMaskVersion = FGameplayInterfaceCache::GetVersion();
+
+	// backwards, removing an entry moves the last one into its index
+	for (int32 EntryIndex = Entries.Num() - 1; EntryIndex >= 0; --EntryIndex)
+	{
+		FInteractiveEntry& Entry = Entries[EntryIndex];
+		AActor* Actor = Entry.Actor.ResolveObjectPtr();
+		if ( !Actor )
+		{
+			continue;
+		}
+
+		Entry.InterfaceMask = FGameplayInterfaceCache::GetMask(Actor->GetClass()) & GetIndexedMask();
+		if ( Entry.InterfaceMask == 0 )
+		{
+			UnregisterActor(Actor);
+		}
+	}
+}
+
+void UInteractiveRegistrySubsystem::HandleLevelAdded(ULevel* Level, UWorld* World)
+{
+	if ( World == GetWorld() && Level && !bNeedsLevelScan )
+	{
+		RegisterLevel(Level);
+	}
+}
+
+void UInteractiveRegistrySubsystem::HandleTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	AActor* Actor = UpdatedComponent->GetOwner();
+	const int32* EntryIndex = EntryIndices.Find(Actor);
+	if ( !EntryIndex )
+	{
+		return;
+	}
+
+	// picking an item up attaches it, which moves it once more
+	if ( IsHeld(Actor) )
+	{
+		MakeDormant(Actor);
+		return;
+	}
+
+	FInteractiveEntry& Entry = Entries[*EntryIndex];
+	Entry.Location = UpdatedComponent->GetComponentLocation();
+
+	const FIntPoint NewCell = GetCell(Entry.Location);
+	if ( NewCell == Entry.Cell )
+	{
+		return;
+	}
+
+	if ( TArray<int32>* CellEntries = Cells.Find(Entry.Cell) )
+	{
+		CellEntries->RemoveSingleSwap(*EntryIndex, false);
+		if ( CellEntries->Num() == 0 )
+		{
+			Cells.Remove(Entry.Cell);
+		}
+	}
+
+	Entry.Cell = NewCell;
+	Cells.FindOrAdd(NewCell).Add(*EntryIndex);
+}
+
+void UInteractiveRegistrySubsystem::HandleActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterActor(Actor);
+}
+
+template<typename FunctionType>
+void UInteractiveRegistrySubsystem::ForEachEntryInRing(const FIntPoint& CenterCell, int32 Ring, FunctionType&& Function) const
+{
+	auto VisitCell = [this, &Function](int32 X, int32 Y)
+	{
+		if ( const TArray<int32>* CellEntries = Cells.Find(FIntPoint(X, Y)) )
+		{
+			for (const int32 EntryIndex : *CellEntries)
+			{
+				Function(Entries[EntryIndex]);
+			}
+		}
+	};
+
+	if ( Ring == 0 )
+	{
+		VisitCell(CenterCell.X, CenterCell.Y);
+		return;
+	}
+
+	// top and bottom rows, then the columns between them
+	for (int32 X = CenterCell.X - Ring; X <= CenterCell.X + Ring; ++X)
+	{
+		VisitCell(X, CenterCell.Y - Ring);
+		VisitCell(X, CenterCell.Y + Ring);
+	}
+
+	for (int32 Y = CenterCell.Y - Ring + 1; Y <= CenterCell.Y + Ring - 1; ++Y)
+	{
+		VisitCell(CenterCell.X - Ring, Y);
+		VisitCell(CenterCell.X + Ring, Y);
+	}
+}
+
+void UInteractiveRegistrySubsystem::FindInRadius(const FVector& Center, float Radius, TSubclassOf<UInterface> SearchClass, TArray<AActor*>& OutActors)
+{
+	ScanLevelsIfNeeded();
+	RefreshInterfaceMasksIfNeeded();
+	WakeDormantActors();
+
+	OutActors.Reset();
+
+	const uint32 SearchMask = FGameplayInterfaceCache::GetInterfaceMask(SearchClass) & GetIndexedMask();
+	const float RadiusSquared = FMath::Square(Radius);
+
+	auto Visit = [&OutActors, &Center, RadiusSquared, SearchMask](const FInteractiveEntry& Entry)
+	{
+		if ( (Entry.InterfaceMask & SearchMask) && FVector::DistSquared(Center, Entry.Location) <= RadiusSquared )
+		{
+			// hiding does not move an actor, so a hidden one can still be indexed
+			AActor* Actor = Entry.Actor.ResolveObjectPtr();
+			if ( Actor && !Actor->IsHidden() )
+			{
+				OutActors.Add(Actor);
+			}
+		}
+	};
+
+	const FIntPoint MinCell = GetCell(Center - FVector(Radius));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Radius));
+	const int64 NumCoveredCells = int64(MaxCell.X - MinCell.X + 1) * int64(MaxCell.Y - MinCell.Y + 1);
+
+	// a radius covering more cells than are occupied is cheaper to answer from the occupied ones
+	if ( NumCoveredCells > Cells.Num() )
+	{
+		for (const FInteractiveEntry& Entry : Entries)
+		{
+			Visit(Entry);
+		}
+		return;
+	}
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			if ( const TArray<int32>* CellEntries = Cells.Find(FIntPoint(X, Y)) )
+			{
+				for (const int32 EntryIndex : *CellEntries)
+				{
+					Visit(Entries[EntryIndex]);
+				}
+			}
+		}
+	}
+}
+
+void UInteractiveRegistrySubsystem::FindNearest(const FVector& Center, float Radius, TSubclassOf<UInterface> SearchClass, int32 MaxResults,
+	TArray<AActor*>& OutActors)
+{
+	ScanLevelsIfNeeded();
+	RefreshInterfaceMasksIfNeeded();
+	WakeDormantActors();
+
+	OutActors.Reset();
+	if ( MaxResults <= 0 )
+	{
+		return;
+	}
+
+	const uint32 SearchMask = FGameplayInterfaceCache::GetInterfaceMask(SearchClass) & GetIndexedMask();
+	const float RadiusSquared = FMath::Square(Radius);
+
+	TArray<FInteractiveCandidate, TInlineAllocator<32>> Candidates;
+	auto Visit = [&Candidates, &Center, RadiusSquared, SearchMask](const FInteractiveEntry& Entry)
+	{
+		if ( Entry.InterfaceMask & SearchMask )
+		{
+			const float DistSquared = FVector::DistSquared(Center, Entry.Location);
+			AActor* Actor = Entry.Actor.ResolveObjectPtr();
+			if ( DistSquared <= RadiusSquared && Actor && !Actor->IsHidden() )
+			{
+				Candidates.Add({ Actor, DistSquared });
+			}
+		}
+	};
+
+	const int32 MaxRing = FMath::CeilToInt(Radius / CellSize);
+	if ( FMath::Square(2 * int64(MaxRing) + 1) > Cells.Num() )
+	{
+		for (const FInteractiveEntry& Entry : Entries)
+		{
+			Visit(Entry);
+		}
+	}
+	else
+	{
+		// grow rings around the center cell until nothing in the next ring can beat the current nearest results
+		const FIntPoint CenterCell = GetCell(Center);
+		for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+		{
+			ForEachEntryInRing(CenterCell, Ring, Visit);
+
+			if ( Candidates.Num() >= MaxResults )
+			{
+				Candidates.Sort();
+				if ( Candidates[MaxResults - 1].DistSquared <= FMath::Square(Ring * CellSize) )
+				{
+					break;
+				}
+			}
+		}
+	}
+
+	Candidates.Sort();
+	for (int32 Index = 0; Index < FMath::Min(Candidates.Num(), MaxResults); ++Index)
+	{
+		OutActors.Add(Candidates[Index].Actor);
+	}
+}
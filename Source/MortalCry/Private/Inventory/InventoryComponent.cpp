@@ -3,154 +3,403 @@
 
 #include "Inventory/InventoryComponent.h"
 
+#include "GameplayInterfaceCache.h"
 #include "Inventory/Collectable.h"
 #include "Inventory/Usable.h"
 #include "Kismet/GameplayStatics.h"
 #include "Net/UnrealNetwork.h"
-#include "UI/Informative.h"
+
+void FInventorySlot::PreReplicatedRemove(const FInventoryList& InArraySerializer)
+{
+	InArraySerializer.Owner->HandleSlotRemoved(*this);
+}
+
+void FInventorySlot::PostReplicatedAdd(const FInventoryList& InArraySerializer)
+{
+	InArraySerializer.Owner->HandleSlotAdded(*this);
+}
+
+void FInventorySlot::PostReplicatedChange(const FInventoryList& InArraySerializer)
+{
+	InArraySerializer.Owner->HandleSlotChanged(*this);
+}
 
 // Sets default values for this component's properties
 UInventoryComponent::UInventoryComponent()
 {
 	Size = 100;
 	MaxItems = 10;
+	UsedSpace = 0;
+	LastPredictionId = 0;
+	LastAckedPredictionId = 0;
+	LastAckedDeferredPredictionId = 0;
 }
 
 
+void UInventoryComponent::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	// after property init, which would copy the owner of the archetype's list
+	Slots.Owner = this;
+}
+
 // Called when the game starts
 void UInventoryComponent::BeginPlay()
 {
 	Super::BeginPlay();	
 }
 
+void UInventoryComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (const TPair<UClass*, AActor*>& Cached : EquipCache)
+	{
+		if (IsValid(Cached.Value))
+		{
+			Cached.Value->Destroy();
+		}
+	}
+	EquipCache.Reset();
+	EquippedItem = nullptr;
+
+	Super::EndPlay(EndPlayReason);
+}
+
 void UInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UInventoryComponent, Items);
+	DOREPLIFETIME(UInventoryComponent, Slots);
 	DOREPLIFETIME(UInventoryComponent, EquippedItem);
+	DOREPLIFETIME_CONDITION(UInventoryComponent, LastAckedPredictionId, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(UInventoryComponent, LastAckedDeferredPredictionId, COND_OwnerOnly);
+}
+
+void UInventoryComponent::OnRep_LastAckedPredictionId()
+{
+	// the slots the server produced arrived in the same update, so the authoritative amounts already include the acked changes
+	TArray<TSubclassOf<AActor>, TInlineAllocator<4>> ChangedClasses;
+	PendingChanges.RemoveAll([this, &ChangedClasses](const FPredictedInventoryChange& Change)
+	{
+		if (Change.PredictionId > (Change.bDeferred ? LastAckedDeferredPredictionId : LastAckedPredictionId))
+		{
+			return false;
+		}
+
+		ChangedClasses.AddUnique(Change.ItemClass);
+		return true;
+	});
+
+	for (TSubclassOf<AActor> ItemClass : ChangedClasses)
+	{
+		OnSlotChanged.Broadcast(ItemClass, GetAmount(ItemClass));
+	}
 }
 
 void UInventoryComponent::Collect(AActor* Item)
 {
 	if ( CanCollect(Item) )
 	{
-		FCollectedItem NewCollectedItem;
-
-		NewCollectedItem.Item = Item->GetClass();
-		NewCollectedItem.Icon = ICollectable::Execute_GetIcon(Item);
-		NewCollectedItem.Name = IInformative::Execute_GetName(Item).ToString();
-		NewCollectedItem.Description = IInformative::Execute_GetDescription(Item).ToString();
-		
-		CollectItem(NewCollectedItem, ICollectable::Execute_GetSize(Item));
+		CollectItem(Item->GetClass(), ICollectable::Execute_GetSize(Item));
 		
 		IInteractive::Execute_Interact(Item, GetOwner());
 	}
 }
 
-void UInventoryComponent::CollectItem_Implementation(FCollectedItem Item, int32 Amount)
+int32 UInventoryComponent::PredictCollect(AActor* Item)
 {
-	if ( !Items.Contains(Item) )
+	if ( !CanCollect(Item) )
 	{
-		Items.Add(Item);
+		return 0;
 	}
-	
-	Items[Item] += Amount;
 
-	if (Items[Item] < 1)
+	return PredictChange(Item->GetClass(), ICollectable::Execute_GetSize(Item));
+}
+
+int32 UInventoryComponent::PredictChange(TSubclassOf<AActor> ItemClass, int32 Amount, bool bDeferred)
+{
+	if ( GetOwnerRole() != ROLE_AutonomousProxy || !ItemClass || Amount == 0 )
 	{
-		Items.Remove(Item);
+		return 0;
+	}
+
+	FPredictedInventoryChange& Change = PendingChanges.AddDefaulted_GetRef();
+	Change.PredictionId = ++LastPredictionId;
+	Change.ItemClass = ItemClass;
+	Change.Amount = Amount;
+	Change.bDeferred = bDeferred;
+
+	OnSlotChanged.Broadcast(ItemClass, GetAmount(ItemClass));
+
+	return Change.PredictionId;
+}
+
+void UInventoryComponent::AckPrediction(int32 PredictionId)
+{
+	// reliable rpcs arrive in order, so one id acks everything sent before it
+	LastAckedPredictionId = FMath::Max(LastAckedPredictionId, PredictionId);
+}
+
+void UInventoryComponent::AckDeferredPrediction(int32 PredictionId)
+{
+	LastAckedDeferredPredictionId = FMath::Max(LastAckedDeferredPredictionId, PredictionId);
+}
+
+int32 UInventoryComponent::GetPendingAmount(int32 PredictionId) const
+{
+	const FPredictedInventoryChange* Change = PendingChanges.FindByPredicate([PredictionId](const FPredictedInventoryChange& Pending)
+	{
+		return Pending.PredictionId == PredictionId;
+	});
+
+	return Change ? Change->Amount : 0;
+}
+
+void UInventoryComponent::CollectItem(TSubclassOf<AActor> ItemClass, int32 Amount)
+{
+	const int32 SlotIndex = FindSlot(ItemClass);
+	if ( SlotIndex == INDEX_NONE )
+	{
+		if ( Amount > 0 )
+		{
+			FInventorySlot& NewSlot = Slots.Slots.AddDefaulted_GetRef();
+			NewSlot.ItemClass = ItemClass;
+			NewSlot.Amount = Amount;
+
+			Slots.MarkItemDirty(NewSlot);
+			HandleSlotAdded(NewSlot);
+		}
+		return;
+	}
+
+	FInventorySlot& Slot = Slots.Slots[SlotIndex];
+	Slot.Amount = FMath::Max(Slot.Amount + Amount, 0);
+
+	if (Slot.Amount < 1)
+	{
+		HandleSlotRemoved(Slot);
+
+		Slots.Slots.RemoveAt(SlotIndex);
+		Slots.MarkArrayDirty();
 		
-		if (EquippedItem && EquippedItem->GetClass() == Item.Item)
+		if (EquippedItem && EquippedItem->GetClass() == ItemClass)
 		{
 			Equip(0, true);
 		}
+
+		ReleaseEquipActor(ItemClass);
+		return;
 	}
+
+	Slots.MarkItemDirty(Slot);
+	HandleSlotChanged(Slot);
 }
 
-bool UInventoryComponent::Contains(TSubclassOf<AActor> ItemClass)
+void UInventoryComponent::HandleSlotAdded(FInventorySlot& Slot)
 {
-	FCollectedItem SearchedItem;
-	SearchedItem.Item = ItemClass;
+	UsedSpace += Slot.Amount;
+	Slot.PreviousAmount = Slot.Amount;
 
-	return Items.Contains(SearchedItem);
+	// the owning client's pending predictions stay layered over whatever the server sent
+	OnSlotAdded.Broadcast(Slot.ItemClass, GetAmount(Slot.ItemClass));
+}
+
+void UInventoryComponent::HandleSlotChanged(FInventorySlot& Slot)
+{
+	UsedSpace += Slot.Amount - Slot.PreviousAmount;
+	Slot.PreviousAmount = Slot.Amount;
+
+	OnSlotChanged.Broadcast(Slot.ItemClass, GetAmount(Slot.ItemClass));
+}
+
+void UInventoryComponent::HandleSlotRemoved(FInventorySlot& Slot)
+{
+	UsedSpace -= Slot.PreviousAmount;
+	Slot.PreviousAmount = 0;
+
+	// the slot is still listed while it is removed, only the predictions outlive it
+	OnSlotRemoved.Broadcast(Slot.ItemClass, FMath::Max(GetPredictedAmount(Slot.ItemClass), 0));
+}
+
+int32 UInventoryComponent::FindSlot(TSubclassOf<AActor> ItemClass) const
+{
+	// a handful of slots at most, a linear scan beats hashing
+	const TArray<FInventorySlot>& SlotArray = GetSlots();
+	for (int32 SlotIndex = 0; SlotIndex < SlotArray.Num(); ++SlotIndex)
+	{
+		if (SlotArray[SlotIndex].ItemClass == ItemClass)
+		{
+			return SlotIndex;
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+int32 UInventoryComponent::GetPredictedAmount(TSubclassOf<AActor> ItemClass) const
+{
+	int32 PredictedAmount = 0;
+	for (const FPredictedInventoryChange& Change : PendingChanges)
+	{
+		if (Change.ItemClass == ItemClass)
+		{
+			PredictedAmount += Change.Amount;
+		}
+	}
+
+	return PredictedAmount;
+}
+
+int32 UInventoryComponent::GetUsedSpace() const
+{
+	int32 PredictedSpace = UsedSpace;
+	for (const FPredictedInventoryChange& Change : PendingChanges)
+	{
+		PredictedSpace += Change.Amount;
+	}
+
+	return FMath::Max(PredictedSpace, 0);
+}
+
+bool UInventoryComponent::Contains(TSubclassOf<AActor> ItemClass) const
+{
+	return GetAmount(ItemClass) > 0;
+}
+
+int32 UInventoryComponent::GetAmount(TSubclassOf<AActor> ItemClass) const
+{
+	const int32 SlotIndex = FindSlot(ItemClass);
+	const int32 Amount = SlotIndex != INDEX_NONE ? GetSlots()[SlotIndex].Amount : 0;
+	return FMath::Max(Amount + GetPredictedAmount(ItemClass), 0);
 }
 
 int32 UInventoryComponent::Use(TSubclassOf<AActor> ItemClass, int32 Amount)
 {
-	if (!Contains(ItemClass))
+	const int32 CollectedAmount = GetAmount(ItemClass);
+	if (CollectedAmount == 0)
 	{
 		return 0;
 	}
 	
-	FCollectedItem SearchedItem;
-	SearchedItem.Item = ItemClass;
-	
-	int32 CollectedAmount = Items[SearchedItem];
 	const bool IsEnough =  CollectedAmount > Amount;
 	const int32 Result = IsEnough ? Amount : CollectedAmount;
-	
-	CollectItem(SearchedItem, -Result);
+
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		CollectItem(ItemClass, -Result);
+	}
+	else
+	{
+		ServerUse(ItemClass, Result, PredictChange(ItemClass, -Result));
+	}
 	
 	return Result;
 }
 
-void UInventoryComponent::Equip_Implementation(int32 Index, const bool IsValid)
+void UInventoryComponent::ServerUse_Implementation(TSubclassOf<AActor> ItemClass, int32 Amount, int32 PredictionId)
+{
+	if (Amount > 0)
+	{
+		Use(ItemClass, Amount);
+	}
+
+	AckPrediction(PredictionId);
+}
+
+bool UInventoryComponent::GetItemInfo(TSubclassOf<AActor> ItemClass, FCollectedItem& OutItemInfo) const
+{
+	UItemInfoSubsystem* ItemInfos = UItemInfoSubsystem::Get(this);
+	return ItemInfos && ItemInfos->GetItemInfo(ItemClass, OutItemInfo);
+}
+
+void UInventoryComponent::Equip(int32 Index, const bool IsValid)
 {
 	if (!IsValid)
 	{
 		return;
 	}
-	
-	if ( GetEquippedItem() )
+
+	ServerEquip(GetSlots().IsValidIndex(Index) ? GetSlots()[Index].ItemClass : nullptr);
+}
+
+void UInventoryComponent::ServerEquip_Implementation(TSubclassOf<AActor> ItemClass)
+{
+	AActor* NewItem = nullptr;
+
+	const int32 Index = ItemClass ? FindSlot(ItemClass) : INDEX_NONE;
+	if ( GetSlots().IsValidIndex(Index) && FGameplayInterfaceCache::Implements(ItemClass, EGameplayInterface::Usable) )
 	{
-		EquippedItem->Destroy();
+		NewItem = GetOrSpawnEquipActor(ItemClass);
 	}
-	
-	EquippedItem = nullptr;
 
-	TArray<FCollectedItem> CollectedItems;
-	Items.GetKeys(CollectedItems);
-	
-	if ( CollectedItems.IsValidIndex(Index) )
+	if ( NewItem == EquippedItem )
 	{
-		const FCollectedItem SelectedItem = CollectedItems[Index];
-		
-		if (SelectedItem.Item->ImplementsInterface(UUsable::StaticClass()))
-		{
-			FActorSpawnParameters Params;
-			Params.Owner = GetOwner();
-			Params.bNoFail = true;
-			Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-			
-			const FVector SpawnLocation = GetOwner()->GetActorLocation();
-			const FRotator SpawnRotation = GetOwner()->GetActorRotation();
-			
-			AActor* Item = GetWorld()->SpawnActor(SelectedItem.Item, &SpawnLocation, &SpawnRotation, Params);
-			Item->SetActorEnableCollision(false);
-			Item->DisableComponentsSimulatePhysics();
-			EquippedItem = Item;
-			EquippedItem->AttachToActor(GetOwner(), FAttachmentTransformRules::SnapToTargetIncludingScale, AttachSocketName);
-		}
+		return;
+	}
+
+	// switching only hides the old actor, it stays cached for the next time its slot is equipped
+	if ( IsValid(EquippedItem) )
+	{
+		SetEquipActorActive(EquippedItem, false);
+	}
+
+	EquippedItem = NewItem;
+
+	if ( EquippedItem )
+	{
+		SetEquipActorActive(EquippedItem, true);
 	}
 }
 
-int32 UInventoryComponent::GetUsedSpace() const
+AActor* UInventoryComponent::GetOrSpawnEquipActor(TSubclassOf<AActor> ItemClass)
 {
-	int32 Result = 0;
-	TArray<int32> ItemsSpace;
-	Items.GenerateValueArray(ItemsSpace);
-	for (int32 ISize : ItemsSpace)
+	AActor*& Item = EquipCache.FindOrAdd(ItemClass);
+	if ( IsValid(Item) )
 	{
-		Result += ISize;
+		return Item;
+	}
+
+	FActorSpawnParameters Params;
+	Params.Owner = GetOwner();
+	Params.bNoFail = true;
+	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	
+	const FVector SpawnLocation = GetOwner()->GetActorLocation();
+	const FRotator SpawnRotation = GetOwner()->GetActorRotation();
+	
+	Item = GetWorld()->SpawnActor(ItemClass, &SpawnLocation, &SpawnRotation, Params);
+	Item->SetActorEnableCollision(false);
+	Item->DisableComponentsSimulatePhysics();
+	Item->AttachToActor(GetOwner(), FAttachmentTransformRules::SnapToTargetIncludingScale, AttachSocketName);
+	SetEquipActorActive(Item, false);
+
+	return Item;
+}
+
+void UInventoryComponent::SetEquipActorActive(AActor* Item, const bool bActive) const
+{
+	Item->SetActorHiddenInGame(!bActive);
+	Item->SetActorTickEnabled(bActive);
+}
+
+void UInventoryComponent::ReleaseEquipActor(TSubclassOf<AActor> ItemClass)
+{
+	AActor* Item = nullptr;
+	if ( EquipCache.RemoveAndCopyValue(ItemClass, Item) && IsValid(Item) )
+	{
+		if ( Item == EquippedItem )
+		{
+			EquippedItem = nullptr;
+		}
+
+		Item->Destroy();
 	}
-	return Result;
 }
 
 bool UInventoryComponent::CanCollect(AActor* Item) const
 {
-	if ( !Item || !Item->Implements<UCollectable>() ) { return false; }
-	if ( Items.Num() >= MaxItems ) { return false; }
+	if ( !Item || !FGameplayInterfaceCache::Implements(Item->GetClass(), EGameplayInterface::Collectable) ) { return false; }
+	if ( GetSlots().Num() >= MaxItems ) { return false; }
 
 	const int32 ItemSize = ICollectable::Execute_GetSize(Item);
 	return GetUsedSpace() + ItemSize <= Size;
@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Inventory/ItemInfoSubsystem.h"
+
+#include "GameplayInterfaceCache.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "Inventory/Collectable.h"
+#include "UI/Informative.h"
+
+const FCollectedItem* UItemInfoSubsystem::FindItemInfo(TSubclassOf<AActor> ItemClass)
+{
+	if ( !ItemClass )
+	{
+		return nullptr;
+	}
+
+	if ( const FCollectedItem* ItemInfo = ItemInfos.Find(ItemClass) )
+	{
+		return ItemInfo;
+	}
+
+	AActor* ItemCDO = ItemClass->GetDefaultObject<AActor>();
+	const bool bCollectable = FGameplayInterfaceCache::Implements(ItemClass, EGameplayInterface::Collectable);
+	const bool bInformative = FGameplayInterfaceCache::Implements(ItemClass, EGameplayInterface::Informative);
+	if ( !bCollectable && !bInformative )
+	{
+		return nullptr;
+	}
+
+	// blueprint implementations run once per class, every later lookup is a map find
+	FCollectedItem& ItemInfo = ItemInfos.Add(ItemClass);
+	ItemInfo.Item = ItemClass;
+
+	if ( bCollectable )
+	{
+		ItemInfo.Icon = ICollectable::Execute_GetIcon(ItemCDO);
+		ItemInfo.Size = ICollectable::Execute_GetSize(ItemCDO);
+	}
+
+	if ( bInformative )
+	{
+		ItemInfo.Name = IInformative::Execute_GetName(ItemCDO);
+		ItemInfo.Description = IInformative::Execute_GetDescription(ItemCDO);
+	}
+
+	return &ItemInfo;
+}
+
+bool UItemInfoSubsystem::GetItemInfo(TSubclassOf<AActor> ItemClass, FCollectedItem& OutItemInfo)
+{
+	if ( const FCollectedItem* ItemInfo = FindItemInfo(ItemClass) )
+	{
+		OutItemInfo = *ItemInfo;
+		return true;
+	}
+
+	return false;
+}
+
+UItemInfoSubsystem* UItemInfoSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+
+	return GameInstance ? GameInstance->GetSubsystem<UItemInfoSubsystem>() : nullptr;
+}
@@ -1,7 +1,43 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
 #include "MortalCry.h"
+#include "GameplayInterfaceCache.h"
 #include "Modules/ModuleManager.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, MortalCry, "MortalCry" );
- 
\ No newline at end of file
+DEFINE_STAT(STAT_WeaponFire);
+DEFINE_STAT(STAT_WeaponTrace);
+DEFINE_STAT(STAT_WeaponHitVerification);
+DEFINE_STAT(STAT_WeaponImpactEffects);
+DEFINE_STAT(STAT_WeaponRPCSend);
+DEFINE_STAT(STAT_WeaponRPCReceive);
+DEFINE_STAT(STAT_WeaponProjectileSimulation);
+DEFINE_STAT(STAT_WeaponPointDamage);
+DEFINE_STAT(STAT_WeaponRadialDamage);
+DEFINE_STAT(STAT_WeaponGenericDamage);
+
+DEFINE_STAT(STAT_WeaponShotsFired);
+DEFINE_STAT(STAT_WeaponTraces);
+DEFINE_STAT(STAT_WeaponHitsVerified);
+DEFINE_STAT(STAT_WeaponHitsRejected);
+DEFINE_STAT(STAT_WeaponImpactsPlayed);
+DEFINE_STAT(STAT_WeaponHitsSent);
+DEFINE_STAT(STAT_WeaponHitsReceived);
+DEFINE_STAT(STAT_WeaponSimulatedProjectiles);
+
+CSV_DEFINE_CATEGORY_MODULE(MORTALCRY_API, MortalCryWeapons, true);
+
+class FMortalCryModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FGameplayInterfaceCache::Startup();
+	}
+
+	virtual void ShutdownModule() override
+	{
+		FGameplayInterfaceCache::Shutdown();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FMortalCryModule, MortalCry, "MortalCry" );
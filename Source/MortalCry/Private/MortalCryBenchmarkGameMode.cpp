@@ -0,0 +1,338 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#include "MortalCryBenchmarkGameMode.h"
+
+#include "Character/MortalCryCharacter.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Weapon/Ranged/RangedWeapon_Instant.h"
+#include "Weapon/Ranged/WeaponTraceSubsystem.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogMortalCryBenchmark, Log, All);
+
+namespace
+{
+	float GetPercentile(const TArray<float>& SortedValues, float Percentile)
+	{
+		if (SortedValues.Num() == 0)
+		{
+			return 0.f;
+		}
+
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+		return SortedValues[Index];
+	}
+
+	/** nanoseconds per TakeDamage call with one kind of damage event */
+	double TimeTakeDamage(AActor* Target, const FDamageEvent& DamageEvent, AActor* DamageCauser, int32 Iterations)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+		{
+			Target->TakeDamage(1.f, DamageEvent, nullptr, DamageCauser);
+		}
+
+		return (FPlatformTime::Seconds() - StartTime) * 1.0e9 / Iterations;
+	}
+}
+
+AMortalCryBenchmarkGameMode::AMortalCryBenchmarkGameMode()
+	: Super()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	DefaultNumBots = 16;
+	DefaultDuration = 30.f;
+	DefaultWarmup = 5.f;
+	SpawnRadius = 400.f;
+
+	NumBots = 0;
+	Duration = 0.f;
+	Warmup = 0.f;
+	ElapsedTime = 0.f;
+	bMeasuring = false;
+	bFinished = false;
+	StartShots = 0;
+	StartTraces = 0;
+	StartBytes = 0;
+}
+
+void AMortalCryBenchmarkGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	NumBots = FMath::Max(0, UGameplayStatics::GetIntOption(Options, TEXT("Bots"), DefaultNumBots));
+
+	Duration = DefaultDuration;
+	if (UGameplayStatics::HasOption(Options, TEXT("Duration")))
+	{
+		Duration = FCString::Atof(*UGameplayStatics::ParseOption(Options, TEXT("Duration")));
+	}
+
+	Warmup = DefaultWarmup;
+	if (UGameplayStatics::HasOption(Options, TEXT("Warmup")))
+	{
+		Warmup = FCString::Atof(*UGameplayStatics::ParseOption(Options, TEXT("Warmup")));
+	}
+
+	WeaponClass = DefaultWeaponClass;
+	if (UGameplayStatics::HasOption(Options, TEXT("Weapon")))
+	{
+		const FString WeaponPath = UGameplayStatics::ParseOption(Options, TEXT("Weapon"));
+		WeaponClass = LoadClass<ARangedWeapon_Instant>(nullptr, *WeaponPath);
+		if (!WeaponClass)
+		{
+			UE_LOG(LogMortalCryBenchmark, Error, TEXT("Could not load weapon class %s"), *WeaponPath);
+		}
+	}
+}
+
+void AMortalCryBenchmarkGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	if (!WeaponClass || !DefaultPawnClass || !DefaultPawnClass->IsChildOf<AMortalCryCharacter>())
+	{
+		UE_LOG(LogMortalCryBenchmark, Error, TEXT("Benchmark needs an instant weapon class and a MortalCry character pawn class"));
+		FinishBenchmark();
+		return;
+	}
+
+	SpawnBots();
+
+	for (ARangedWeapon_Instant* Weapon : BotWeapons)
+	{
+		Weapon->ForceInfiniteAmmo();
+		Weapon->StartFire();
+	}
+
+	UE_LOG(LogMortalCryBenchmark, Log, TEXT("Firing with %d bots, %.1fs warmup, %.1fs measured"), BotWeapons.Num(), Warmup, Duration);
+}
+
+void AMortalCryBenchmarkGameMode::SpawnBots()
+{
+	const AActor* PlayerStart = FindPlayerStart(nullptr);
+	const FVector Origin = PlayerStart ? PlayerStart->GetActorLocation() : FVector::ZeroVector;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 BotIndex = 0; BotIndex < NumBots; ++BotIndex)
+	{
+		// bots face outwards so they shoot the level instead of killing each other
+		const float Angle = 2.f * PI * BotIndex / NumBots;
+		const FVector Direction(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+		const FVector Location = Origin + Direction * SpawnRadius;
+
+		AMortalCryCharacter* Bot = GetWorld()->SpawnActor<AMortalCryCharacter>(*DefaultPawnClass, Location, Direction.Rotation(), SpawnParams);
+		if (!Bot)
+		{
+			continue;
+		}
+
+		Bot->SpawnDefaultController();
+		Bots.Add(Bot);
+
+		ARangedWeapon_Instant* Weapon = GetWorld()->SpawnActor<ARangedWeapon_Instant>(WeaponClass, Bot->GetActorTransform(), SpawnParams);
+		if (!Weapon)
+		{
+			continue;
+		}
+
+		Bot->PickUp(Weapon);
+		if (Weapon->GetMyPawn() != Bot)
+		{
+			UE_LOG(LogMortalCryBenchmark, Warning, TEXT("%s could not equip %s"), *GetNameSafe(Bot), *GetNameSafe(Weapon));
+			Weapon->Destroy();
+			continue;
+		}
+
+		BotWeapons.Add(Weapon);
+	}
+}
+
+void AMortalCryBenchmarkGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	ElapsedTime += DeltaSeconds;
+
+	if (!bMeasuring)
+	{
+		if (ElapsedTime >= Warmup)
+		{
+			StartMeasuring();
+		}
+		return;
+	}
+
+	// game thread work of the last frame, idle time waiting for the next server tick is left out
+	FrameTimes.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+
+	if (ElapsedTime >= Warmup + Duration)
+	{
+		FinishBenchmark();
+	}
+}
+
+void AMortalCryBenchmarkGameMode::StartMeasuring()
+{
+	bMeasuring = true;
+
+	int32 NumClients = 0;
+	StartShots = GetTotalShots();
+	StartTraces = GetTotalTraces();
+	StartBytes = GetTotalBytesSent(NumClients);
+
+	FrameTimes.Reset();
+	FrameTimes.Reserve(FMath::CeilToInt(Duration * 120.f));
+}
+
+void AMortalCryBenchmarkGameMode::FinishBenchmark()
+{
+	bFinished = true;
+
+	for (ARangedWeapon_Instant* Weapon : BotWeapons)
+	{
+		if (Weapon)
+		{
+			Weapon->StopFire();
+		}
+	}
+
+	if (bMeasuring)
+	{
+		const float MeasuredTime = FMath::Max(ElapsedTime - Warmup, KINDA_SMALL_NUMBER);
+
+		int32 NumClients = 0;
+		const int64 Shots = GetTotalShots() - StartShots;
+		const uint64 Traces = GetTotalTraces() - StartTraces;
+		const int64 Bytes = GetTotalBytesSent(NumClients) - StartBytes;
+
+		TArray<float> SortedFrameTimes = FrameTimes;
+		SortedFrameTimes.Sort();
+
+		FString Report;
+		Report += TEXT("{\n");
+		Report += FString::Printf(TEXT("\t\"Bots\": %d,\n"), BotWeapons.Num());
+		Report += FString::Printf(TEXT("\t\"Weapon\": \"%s\",\n"), *GetNameSafe(WeaponClass));
+		Report += FString::Printf(TEXT("\t\"Duration\": %.3f,\n"), MeasuredTime);
+		Report += FString::Printf(TEXT("\t\"Frames\": %d,\n"), SortedFrameTimes.Num());
+		Report += FString::Printf(TEXT("\t\"FrameTimeP50\": %.3f,\n"), GetPercentile(SortedFrameTimes, 0.5f));
+		Report += FString::Printf(TEXT("\t\"FrameTimeP90\": %.3f,\n"), GetPercentile(SortedFrameTimes, 0.9f));
+		Report += FString::Printf(TEXT("\t\"FrameTimeP99\": %.3f,\n"), GetPercentile(SortedFrameTimes, 0.99f));
+		Report += FString::Printf(TEXT("\t\"FrameTimeMax\": %.3f,\n"), SortedFrameTimes.Num() > 0 ? SortedFrameTimes.Last() : 0.f);
+		Report += FString::Printf(TEXT("\t\"ShotsPerSecond\": %.1f,\n"), Shots / MeasuredTime);
+		Report += FString::Printf(TEXT("\t\"TracesPerSecond\": %.1f,\n"), Traces / MeasuredTime);
+		Report += FString::Printf(TEXT("\t\"Clients\": %d,\n"), NumClients);
+		Report += FString::Printf(TEXT("\t\"BytesPerClientPerSecond\": %.1f\n"), NumClients > 0 ? Bytes / (NumClients * MeasuredTime) : 0.f);
+		Report += TEXT("}\n");
+
+		UE_LOG(LogMortalCryBenchmark, Display, TEXT("Weapon throughput results:\n%s"), *Report);
+
+		const FString ReportPath = FPaths::ProfilingDir() / TEXT("Benchmark") / FString::Printf(TEXT("WeaponThroughput-%s.json"), *FDateTime::Now().ToString());
+		if (FFileHelper::SaveStringToFile(Report, *ReportPath))
+		{
+			UE_LOG(LogMortalCryBenchmark, Display, TEXT("Results written to %s"), *ReportPath);
+		}
+	}
+
+	if (!GIsEditor)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+int64 AMortalCryBenchmarkGameMode::GetTotalShots() const
+{
+	int64 TotalShots = 0;
+	for (const ARangedWeapon_Instant* Weapon : BotWeapons)
+	{
+		if (Weapon)
+		{
+			TotalShots += Weapon->GetBurstCounter();
+		}
+	}
+
+	return TotalShots;
+}
+
+uint64 AMortalCryBenchmarkGameMode::GetTotalTraces() const
+{
+	const UWeaponTraceSubsystem* TraceSubsystem = GetWorld()->GetSubsystem<UWeaponTraceSubsystem>();
+	return TraceSubsystem ? TraceSubsystem->GetNumTracesFlushed() : 0;
+}
+
+int64 AMortalCryBenchmarkGameMode::GetTotalBytesSent(int32& OutNumClients) const
+{
+	OutNumClients = 0;
+
+	int64 TotalBytes = 0;
+	if (const UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		for (const UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection)
+			{
+				TotalBytes += Connection->OutTotalBytes;
+				++OutNumClients;
+			}
+		}
+	}
+
+	return TotalBytes;
+}
+
+void AMortalCryBenchmarkGameMode::BenchmarkDamage(int32 Iterations)
+{
+	if (Iterations <= 0 || !DefaultPawnClass || !DefaultPawnClass->IsChildOf<AMortalCryCharacter>())
+	{
+		UE_LOG(LogMortalCryBenchmark, Error, TEXT("Damage benchmark needs a positive iteration count and a MortalCry character pawn class"));
+		return;
+	}
+
+	// away from the bots, so nothing else damages the target while it is timed
+	const AActor* PlayerStart = FindPlayerStart(nullptr);
+	const FVector Location = (PlayerStart ? PlayerStart->GetActorLocation() : FVector::ZeroVector) + FVector(0.f, 0.f, 10.f * SpawnRadius);
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AMortalCryCharacter* Target = GetWorld()->SpawnActor<AMortalCryCharacter>(*DefaultPawnClass, Location, FRotator::ZeroRotator, SpawnParams);
+	if (!Target)
+	{
+		UE_LOG(LogMortalCryBenchmark, Error, TEXT("Could not spawn a damage benchmark target"));
+		return;
+	}
+
+	FHitResult Hit(Target, nullptr, Location, -FVector::ForwardVector);
+	Hit.TraceStart = Location + FVector::ForwardVector * 1000.f;
+	Hit.TraceEnd = Location;
+
+	FPointDamageEvent PointDamage(1.f, Hit, -FVector::ForwardVector, nullptr);
+
+	FRadialDamageEvent RadialDamage;
+	RadialDamage.Origin = Hit.TraceStart;
+	RadialDamage.Params = FRadialDamageParams(1.f, 1000.f);
+	RadialDamage.ComponentHits.Add(Hit);
+
+	const FDamageEvent GenericDamage;
+
+	const double PointTime = TimeTakeDamage(Target, PointDamage, this, Iterations);
+	const double RadialTime = TimeTakeDamage(Target, RadialDamage, this, Iterations);
+	const double GenericTime = TimeTakeDamage(Target, GenericDamage, this, Iterations);
+
+	Target->Destroy();
+
+	UE_LOG(LogMortalCryBenchmark, Display, TEXT("TakeDamage over %d calls each: point %.1fns, radial %.1fns, generic %.1fns"),
+		Iterations, PointTime, RadialTime, GenericTime);
+}
@@ -3,8 +3,8 @@
 #include "UI/MortalCryHUD.h"
 
 #include "CanvasItem.h"
-#include "UI/Informative.h"
-#include "Player/MortalCryPlayerController.h"
+#include "Blueprint/UserWidget.h"
+#include "Character/MortalCryCharacter.h"
 #include "TextureResource.h"
 #include "Engine/Canvas.h"
 #include "Engine/Texture2D.h"
@@ -15,25 +15,105 @@ AMortalCryHUD::AMortalCryHUD()
 	// Set the crosshair texture
 	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshairTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
 	CrosshairTex = CrosshairTexObj.Object;
+
+	CrosshairWidget = nullptr;
+	FocusedActor = nullptr;
 }
 
-void AMortalCryHUD::DrawTextFor_Implementation(AActor* InteractiveActor)
-{}
+void AMortalCryHUD::BeginPlay()
+{
+	Super::BeginPlay();
+
+	APlayerController* PC = GetOwningPlayerController();
+	if ( !PC )
+	{
+		return;
+	}
+
+	if ( CrosshairWidgetClass )
+	{
+		CrosshairWidget = CreateWidget<UUserWidget>(PC, CrosshairWidgetClass);
+		if ( CrosshairWidget )
+		{
+			CrosshairWidget->AddToViewport();
+		}
+	}
+
+	// the prompt follows whichever character the player controls
+	NewPawnHandle = PC->GetOnNewPawnNotifier().AddUObject(this, &AMortalCryHUD::HandleNewPawn);
+	HandleNewPawn(PC->GetPawn());
+}
+
+void AMortalCryHUD::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if ( APlayerController* PC = GetOwningPlayerController() )
+	{
+		PC->GetOnNewPawnNotifier().Remove(NewPawnHandle);
+	}
+
+	HandleNewPawn(nullptr);
+
+	if ( CrosshairWidget )
+	{
+		CrosshairWidget->RemoveFromParent();
+		CrosshairWidget = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
 
-void AMortalCryHUD::TraceForInteractiveActors()
+void AMortalCryHUD::HandleNewPawn(APawn* NewPawn)
 {
-	if ( AMortalCryPlayerController* PC = Cast<AMortalCryPlayerController>(GetOwningPlayerController()) )
+	if ( AMortalCryCharacter* OldCharacter = ObservedCharacter.Get() )
 	{
-		DrawTextFor(PC->Trace(UInformative::StaticClass()));
+		OldCharacter->OnInteractFocusChanged.RemoveDynamic(this, &AMortalCryHUD::HandleInteractFocusChanged);
 	}
+
+	AMortalCryCharacter* NewCharacter = Cast<AMortalCryCharacter>(NewPawn);
+	ObservedCharacter = NewCharacter;
+
+	if ( NewCharacter )
+	{
+		NewCharacter->OnInteractFocusChanged.AddDynamic(this, &AMortalCryHUD::HandleInteractFocusChanged);
+	}
+
+	HandleInteractFocusChanged(NewCharacter ? NewCharacter->GetInteractFocus() : nullptr);
+}
+
+void AMortalCryHUD::HandleInteractFocusChanged(AActor* NewFocus)
+{
+	if ( NewFocus == FocusedActor )
+	{
+		return;
+	}
+
+	FocusedActor = NewFocus;
+	OnInteractFocusChanged(NewFocus);
+}
+
+void AMortalCryHUD::DrawTextFor_Implementation(AActor* InteractiveActor)
+{}
+
+bool AMortalCryHUD::GetItemInfo(AActor* Actor, FCollectedItem& OutItemInfo) const
+{
+	UItemInfoSubsystem* ItemInfos = UItemInfoSubsystem::Get(this);
+	return Actor && ItemInfos && ItemInfos->GetItemInfo(Actor->GetClass(), OutItemInfo);
 }
 
 void AMortalCryHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
-	DrawCrossHair();
-	TraceForInteractiveActors();
+	// nothing is traced here, the focus is pushed by the character when it changes
+	if ( !CrosshairWidget )
+	{
+		DrawCrossHair();
+	}
+
+	if ( IsValid(FocusedActor) )
+	{
+		DrawTextFor(FocusedActor);
+	}
 }
 
 void AMortalCryHUD::DrawCrossHair_Implementation()
@@ -3,54 +3,169 @@
 
 #include "Weapon/Ranged/ImpactEffect.h"
 
+#include "Components/DecalComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Kismet/GameplayStatics.h"
 #include "PhysicalMaterials/PhysicalMaterial.h"
 #include "Sound/SoundCue.h"
+#include "TimerManager.h"
+#include "Weapon/WeaponSettings.h"
 
 AImpactEffect::AImpactEffect(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
-	SetAutoDestroyWhenFinished(true);
+	DecalComponent = ObjectInitializer.CreateDefaultSubobject<UDecalComponent>(this, TEXT("DecalComponent"));
+	DecalComponent->SetVisibility(false);
+	RootComponent = DecalComponent;
 }
 
-void AImpactEffect::PostInitializeComponents()
+void AImpactEffect::PlayImpact(const FHitResult& Impact)
 {
-	Super::PostInitializeComponents();
+	ResetImpact();
+
+	SurfaceHit = Impact;
+	SetActorLocationAndRotation(Impact.ImpactPoint, Impact.ImpactNormal.Rotation());
 
 	UPhysicalMaterial* HitPhysMat = SurfaceHit.PhysMaterial.Get();
-	//EPhysicalSurface HitSurfaceType = UPhysicalMaterial::DetermineSurfaceType(HitPhysMat);
+	const EPhysicalSurface HitSurfaceType = UPhysicalMaterial::DetermineSurfaceType(HitPhysMat);
 
-	UParticleSystem* ImpactFX = DefaultFX;
+	// emitters go through the engine component pool, they are released back once finished
+	UParticleSystem* ImpactFX = GetImpactFX(HitSurfaceType);
 	if (ImpactFX)
 	{
-		UGameplayStatics::SpawnEmitterAtLocation(this, ImpactFX, GetActorLocation(), GetActorRotation());
+		UGameplayStatics::SpawnEmitterAtLocation(this, ImpactFX, GetActorLocation(), GetActorRotation(),
+			FVector(1.f), true, EPSCPoolMethod::AutoRelease);
 	}
 
 	// play sound
-	USoundCue* ImpactSound = DefaultSound;
+	USoundCue* ImpactSound = GetImpactSound(HitSurfaceType);
 	if (ImpactSound)
 	{
 		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
 	}
 
-	if (DefaultDecal.DecalMaterial)
+	const FDecalData& ImpactDecal = GetImpactDecal(HitSurfaceType);
+	if (ImpactDecal.DecalMaterial)
 	{
 		FRotator RandomDecalRotation = SurfaceHit.ImpactNormal.Rotation();
 		RandomDecalRotation.Roll = FMath::FRandRange(-180.0f, 180.0f);
 
-		UGameplayStatics::SpawnDecalAttached(DefaultDecal.DecalMaterial, FVector(1.0f, DefaultDecal.DecalSize, DefaultDecal.DecalSize),
-			SurfaceHit.Component.Get(), SurfaceHit.BoneName,
-			SurfaceHit.ImpactPoint, RandomDecalRotation, EAttachLocation::KeepWorldPosition,
-			DefaultDecal.LifeSpan);
+		if (USceneComponent* HitComponent = SurfaceHit.Component.Get())
+		{
+			DecalComponent->AttachToComponent(HitComponent, FAttachmentTransformRules::KeepWorldTransform, SurfaceHit.BoneName);
+		}
+
+		DecalComponent->SetDecalMaterial(ImpactDecal.DecalMaterial);
+		DecalComponent->DecalSize = FVector(1.0f, ImpactDecal.DecalSize, ImpactDecal.DecalSize);
+		DecalComponent->SetWorldLocationAndRotation(SurfaceHit.ImpactPoint, RandomDecalRotation);
+		DecalComponent->SetVisibility(true);
+
+		// a decal that never expires would keep its instance out of the pool for good
+		const float LifeSpan = ImpactDecal.LifeSpan > 0.f ? ImpactDecal.LifeSpan : UWeaponSettings::Get()->DefaultImpactDecalLifeSpan;
+		GetWorldTimerManager().SetTimer(TimerHandle_ResetImpact, this, &AImpactEffect::ResetImpact, FMath::Max(LifeSpan, 0.1f), false);
+	}
+}
+
+void AImpactEffect::ResetImpact()
+{
+	GetWorldTimerManager().ClearTimer(TimerHandle_ResetImpact);
+
+	DecalComponent->SetVisibility(false);
+	if (DecalComponent->GetAttachParent())
+	{
+		DecalComponent->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+}
+
+bool AImpactEffect::IsPlaying() const
+{
+	return DecalComponent->IsVisible();
+}
+
+TSharedPtr<FImpactSurfaceTable> AImpactEffect::CreateSurfaceTable() const
+{
+	TSharedPtr<FImpactSurfaceTable> Table = MakeShared<FImpactSurfaceTable>();
+	ResolveSurfaceTable(*Table);
+
+	TArray<FSoftObjectPath> AssetsToLoad;
+	for (const FImpactSurfaceData& Surface : SurfaceOverrides)
+	{
+		for (const FSoftObjectPath& Path : { Surface.FX.ToSoftObjectPath(), Surface.Sound.ToSoftObjectPath(), Surface.DecalMaterial.ToSoftObjectPath() })
+		{
+			if (Path.IsValid())
+			{
+				AssetsToLoad.AddUnique(Path);
+			}
+		}
+	}
+
+	if (AssetsToLoad.Num() > 0)
+	{
+		// hits keep using the defaults until the overrides are in, so the game thread never waits on a load
+		TWeakPtr<FImpactSurfaceTable> WeakTable = Table;
+		TWeakObjectPtr<const AImpactEffect> WeakTemplate = this;
+		Table->PreloadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(AssetsToLoad,
+			FStreamableDelegate::CreateLambda([WeakTable, WeakTemplate]()
+			{
+				TSharedPtr<FImpactSurfaceTable> LoadedTable = WeakTable.Pin();
+				if (LoadedTable.IsValid() && WeakTemplate.IsValid())
+				{
+					WeakTemplate->ResolveSurfaceTable(*LoadedTable);
+				}
+			}));
+	}
+
+	return Table;
+}
+
+void AImpactEffect::SetSurfaceTable(const TSharedPtr<const FImpactSurfaceTable>& InSurfaceTable)
+{
+	SurfaceTable = InSurfaceTable;
+}
+
+void AImpactEffect::ResolveSurfaceTable(FImpactSurfaceTable& Table) const
+{
+	for (FImpactSurfaceEffects& Entry : Table.Entries)
+	{
+		Entry.FX = DefaultFX;
+		Entry.Sound = DefaultSound;
+		Entry.Decal = DefaultDecal;
+	}
+
+	for (const FImpactSurfaceData& Surface : SurfaceOverrides)
+	{
+		FImpactSurfaceEffects& Entry = Table.Entries[Surface.SurfaceType];
+
+		if (UParticleSystem* FX = Surface.FX.Get())
+		{
+			Entry.FX = FX;
+		}
+
+		if (USoundCue* Sound = Surface.Sound.Get())
+		{
+			Entry.Sound = Sound;
+		}
+
+		if (UMaterial* DecalMaterial = Surface.DecalMaterial.Get())
+		{
+			Entry.Decal.DecalMaterial = DecalMaterial;
+			Entry.Decal.DecalSize = Surface.DecalSize;
+			Entry.Decal.LifeSpan = Surface.DecalLifeSpan;
+		}
 	}
 }
 
 UParticleSystem* AImpactEffect::GetImpactFX(TEnumAsByte<EPhysicalSurface> SurfaceType) const
 {
-	return DefaultFX;
+	return SurfaceTable.IsValid() ? SurfaceTable->Get(SurfaceType).FX : DefaultFX;
 }
 
 USoundCue* AImpactEffect::GetImpactSound(TEnumAsByte<EPhysicalSurface> SurfaceType) const
 {
-	return DefaultSound;
+	return SurfaceTable.IsValid() ? SurfaceTable->Get(SurfaceType).Sound : DefaultSound;
 }
 
+const FDecalData& AImpactEffect::GetImpactDecal(TEnumAsByte<EPhysicalSurface> SurfaceType) const
+{
+	return SurfaceTable.IsValid() ? SurfaceTable->Get(SurfaceType).Decal : DefaultDecal;
+}
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/Ranged/ImpactEffectSubsystem.h"
+
+#include "Engine/World.h"
+#include "Weapon/WeaponSettings.h"
+#include "Weapon/Ranged/ImpactEffect.h"
+
+UImpactEffectSubsystem::UImpactEffectSubsystem()
+{
+	NumSpawnsAvoided = 0;
+}
+
+FImpactEffectPool& UImpactEffectSubsystem::GetPool(TSubclassOf<AImpactEffect> Template)
+{
+	FImpactEffectPool& Pool = Pools.FindOrAdd(Template);
+	if ( !Pool.SurfaceTable.IsValid() )
+	{
+		Pool.SurfaceTable = Template->GetDefaultObject<AImpactEffect>()->CreateSurfaceTable();
+	}
+
+	return Pool;
+}
+
+AImpactEffect* UImpactEffectSubsystem::SpawnInstance(TSubclassOf<AImpactEffect> Template, const FImpactEffectPool& Pool) const
+{
+	FActorSpawnParameters Params;
+	Params.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	Params.ObjectFlags |= RF_Transient;
+
+	AImpactEffect* Effect = GetWorld()->SpawnActor<AImpactEffect>(Template, FTransform::Identity, Params);
+	if ( Effect )
+	{
+		Effect->SetSurfaceTable(Pool.SurfaceTable);
+	}
+
+	return Effect;
+}
+
+void UImpactEffectSubsystem::PreloadImpact(TSubclassOf<AImpactEffect> Template)
+{
+	if ( Template )
+	{
+		GetPool(Template);
+	}
+}
+
+void UImpactEffectSubsystem::PlayImpact(TSubclassOf<AImpactEffect> Template, const FHitResult& Impact)
+{
+	if ( !Template )
+	{
+		return;
+	}
+
+	FImpactEffectPool& Pool = GetPool(Template);
+	Pool.Instances.RemoveAll([](const AImpactEffect* Instance) { return !IsValid(Instance); });
+	Pool.NextIndex = Pool.Instances.Num() > 0 ? Pool.NextIndex % Pool.Instances.Num() : 0;
+
+	const int32 PoolSize = UWeaponSettings::Get()->ImpactEffectPoolSize;
+
+	AImpactEffect* Effect = nullptr;
+
+	// reuse the least recently used instance once it is done, or when the pool is full
+	if ( Pool.Instances.Num() > 0 && (Pool.Instances.Num() >= PoolSize || !Pool.Instances[Pool.NextIndex]->IsPlaying()) )
+	{
+		Effect = Pool.Instances[Pool.NextIndex];
+		++NumSpawnsAvoided;
+	}
+	else
+	{
+		Effect = SpawnInstance(Template, Pool);
+		if ( !Effect )
+		{
+			return;
+		}
+
+		// new instances go in right before the next one to recycle, keeping the pool in activation order
+		Pool.Instances.Insert(Effect, Pool.NextIndex);
+	}
+
+	Pool.NextIndex = (Pool.NextIndex + 1) % Pool.Instances.Num();
+
+	Effect->PlayImpact(Impact);
+}
@@ -3,6 +3,39 @@
 #include "Weapon/Ranged/MortalCryProjectile.h"
 #include "GameFramework/ProjectileMovementComponent.h"
 #include "Components/SphereComponent.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "Weapon/Ranged/ProjectilePoolSubsystem.h"
+
+void FDamageFalloffTable::Bake(const FRuntimeFloatCurve& Curve, float InInputRange)
+{
+	Samples.Reset();
+	InputRange = FMath::Max(InInputRange, KINDA_SMALL_NUMBER);
+
+	const FRichCurve* RichCurve = Curve.GetRichCurveConst();
+	if ( !RichCurve || RichCurve->GetNumKeys() == 0 )
+	{
+		return;
+	}
+
+	Samples.SetNumUninitialized(NumSamples);
+	for (int32 Index = 0; Index < NumSamples; ++Index)
+	{
+		Samples[Index] = RichCurve->Eval(InputRange * Index / (NumSamples - 1));
+	}
+}
+
+float FDamageFalloffTable::Evaluate(float Input) const
+{
+	if ( Samples.Num() == 0 )
+	{
+		return 1.f;
+	}
+
+	const float Position = FMath::Clamp(Input / InputRange, 0.f, 1.f) * (Samples.Num() - 1);
+	const int32 Index = FMath::Min(FMath::FloorToInt(Position), Samples.Num() - 2);
+	return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - Index);
+}
 
 AMortalCryProjectile::AMortalCryProjectile() 
 {
@@ -27,8 +60,93 @@ AMortalCryProjectile::AMortalCryProjectile()
 	ProjectileMovement->bRotationFollowsVelocity = true;
 	ProjectileMovement->bShouldBounce = true;
 	
-	// Die after 3 seconds by default
-	InitialLifeSpan = 3.0f;
+	// Back to the pool after 3 seconds by default
+	ProjectileLifeSpan = 3.0f;
+	bProjectileActive = false;
+	bPooled = false;
+	LaunchLocation = FVector::ZeroVector;
+	InitialVelocity = FVector::ZeroVector;
+}
+
+void AMortalCryProjectile::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// baked once per instance, pooled projectiles keep their tables between flights
+	DamageFalloffTable.Bake(ProjectileConfig.DamageFalloff, ProjectileConfig.FalloffRange);
+	ExplosionFalloffTable.Bake(ProjectileConfig.ExplosionFalloff, 1.f);
+
+	// the movement component already turned its velocity into a world launch velocity, the class default keeps the configured one
+	const UProjectileMovementComponent* DefaultMovement = GetClass()->GetDefaultObject<AMortalCryProjectile>()->GetProjectileMovement();
+	InitialVelocity = DefaultMovement->Velocity.IsNearlyZero() ? FVector::ForwardVector : DefaultMovement->Velocity;
+	if ( DefaultMovement->InitialSpeed > 0.f )
+	{
+		InitialVelocity = InitialVelocity.GetSafeNormal() * DefaultMovement->InitialSpeed;
+	}
+}
+
+void AMortalCryProjectile::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// projectiles spawned outside the pool fly from where they were placed, the pool activates its own once they are set up
+	if ( bPooled )
+	{
+		StopProjectile();
+	}
+	else
+	{
+		ActivateProjectile(GetActorLocation(), GetActorRotation());
+	}
+}
+
+void AMortalCryProjectile::ActivateProjectile(const FVector& Location, const FRotator& Rotation)
+{
+	bProjectileActive = true;
+	LaunchLocation = Location;
+
+	SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::ResetPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+
+	// a pooled instance still carries the movement of its last flight
+	ProjectileMovement->SetUpdatedComponent(CollisionComp);
+	ProjectileMovement->Velocity = ProjectileMovement->bInitialVelocityInLocalSpace ? Rotation.RotateVector(InitialVelocity) : InitialVelocity;
+	ProjectileMovement->UpdateComponentVelocity();
+	ProjectileMovement->Activate(true);
+
+	GetWorldTimerManager().SetTimer(TimerHandle_Expire, this, &AMortalCryProjectile::DeactivateProjectile, ProjectileLifeSpan, false);
+}
+
+void AMortalCryProjectile::DeactivateProjectile()
+{
+	if ( !bProjectileActive )
+	{
+		return;
+	}
+
+	bProjectileActive = false;
+	GetWorldTimerManager().ClearTimer(TimerHandle_Expire);
+
+	StopProjectile();
+
+	UProjectilePoolSubsystem* Pool = bPooled ? GetWorld()->GetSubsystem<UProjectilePoolSubsystem>() : nullptr;
+	if ( Pool )
+	{
+		Pool->ReleaseProjectile(this);
+	}
+	else
+	{
+		Destroy();
+	}
+}
+
+void AMortalCryProjectile::StopProjectile()
+{
+	ProjectileMovement->StopMovementImmediately();
+	ProjectileMovement->Deactivate();
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
 }
 
 void AMortalCryProjectile::OnHit_Implementation(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
@@ -38,17 +156,93 @@ void AMortalCryProjectile::OnHit_Implementation(UPrimitiveComponent* HitComp, AA
 	{
 		if ( OtherComp && OtherComp->IsSimulatingPhysics() )
 		{
-			OtherComp->AddImpulseAtLocation(GetVelocity() * 100.0f, GetActorLocation());
+			OtherComp->AddImpulseAtLocation(GetVelocity() * ProjectileConfig.ImpulseScale, GetActorLocation());
 		}
 		
 		if ( OtherActor->CanBeDamaged() )
 		{
+			const float Damage = ProjectileConfig.HitDamage * DamageFalloffTable.Evaluate(FVector::Dist(LaunchLocation, Hit.ImpactPoint));
+
 			FPointDamageEvent DamageEvent = FPointDamageEvent();
-			DamageEvent.Damage = 100.f;
+			DamageEvent.DamageTypeClass = ProjectileConfig.DamageType;
+			DamageEvent.Damage = Damage;
 			DamageEvent.HitInfo = Hit;
-			OtherActor->TakeDamage(100.f, DamageEvent, nullptr, this);
+			DamageEvent.ShotDirection = GetVelocity().GetSafeNormal();
+			OtherActor->TakeDamage(Damage, DamageEvent, GetInstigatorController(), this);
+		}
+
+		if ( ProjectileConfig.ExplosionRadius > 0.f )
+		{
+			ApplyExplosionDamage(Hit.ImpactPoint);
+		}
+
+		DeactivateProjectile();
+	}
+}
+
+void AMortalCryProjectile::ApplyExplosionDamage(const FVector& Origin)
+{
+	const float Radius = ProjectileConfig.ExplosionRadius;
+
+	// by object type like UGameplayStatics::ApplyRadialDamage, pawns ignore the trace channels
+	TArray<FOverlapResult> Overlaps;
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ProjectileExplosion), false, this);
+	GetWorld()->OverlapMultiByObjectType(Overlaps, Origin, FQuat::Identity, FCollisionObjectQueryParams(FCollisionObjectQueryParams::InitType::AllDynamicObjects),
+		FCollisionShape::MakeSphere(Radius), QueryParams);
+
+	// every overlapped component of a victim goes into one damage event, so it is damaged once from its closest part
+	TMap<AActor*, TArray<FHitResult>> VictimHits;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		AActor* Victim = Overlap.GetActor();
+		UPrimitiveComponent* Component = Overlap.GetComponent();
+		if ( !Victim || !Component || !Victim->CanBeDamaged() )
+		{
+			continue;
+		}
+
+		FVector ClosestPoint;
+		if ( Component->GetClosestPointOnCollision(Origin, ClosestPoint) < 0.f )
+		{
+			ClosestPoint = Component->GetComponentLocation();
+		}
+
+		VictimHits.FindOrAdd(Victim).Emplace(Victim, Component, ClosestPoint, (ClosestPoint - Origin).GetSafeNormal());
+	}
+
+	AController* InstigatorController = GetInstigatorController();
+
+	for (TPair<AActor*, TArray<FHitResult>>& Victim : VictimHits)
+	{
+		float ClosestDistSq = MAX_flt;
+		FVector ClosestPoint = Origin;
+		for (const FHitResult& ComponentHit : Victim.Value)
+		{
+			const float DistSq = FVector::DistSquared(Origin, ComponentHit.ImpactPoint);
+			if ( DistSq < ClosestDistSq )
+			{
+				ClosestDistSq = DistSq;
+				ClosestPoint = ComponentHit.ImpactPoint;
+			}
+		}
+
+		// one trace to the closest part, anything else in the way shields the whole victim
+		FHitResult Occluder;
+		if ( GetWorld()->LineTraceSingleByChannel(Occluder, Origin, ClosestPoint, ProjectileConfig.ExplosionOcclusionChannel, QueryParams)
+			&& Occluder.GetActor() != Victim.Key )
+		{
+			continue;
 		}
 
-		//Destroy();
+		const float Damage = ProjectileConfig.ExplosionDamage * ExplosionFalloffTable.Evaluate(FMath::Sqrt(ClosestDistSq) / Radius);
+
+		// the falloff is already in the damage, equal inner and outer radii keep the engine from scaling it again
+		FRadialDamageEvent DamageEvent;
+		DamageEvent.DamageTypeClass = ProjectileConfig.ExplosionDamageType;
+		DamageEvent.Params = FRadialDamageParams(Damage, 0.f, Radius, Radius, 0.f);
+		DamageEvent.Origin = Origin;
+		DamageEvent.ComponentHits = MoveTemp(Victim.Value);
+
+		Victim.Key->TakeDamage(Damage, DamageEvent, InstigatorController, this);
 	}
-}
\ No newline at end of file
+}
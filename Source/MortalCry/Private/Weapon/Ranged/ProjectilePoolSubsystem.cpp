@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/Ranged/ProjectilePoolSubsystem.h"
+
+#include "Engine/World.h"
+#include "Weapon/WeaponSettings.h"
+#include "Weapon/Ranged/MortalCryProjectile.h"
+
+UProjectilePoolSubsystem::UProjectilePoolSubsystem()
+{
+	NumSpawnsAvoided = 0;
+}
+
+FProjectilePool& UProjectilePoolSubsystem::GetPool(TSubclassOf<AMortalCryProjectile> ProjectileClass)
+{
+	FProjectilePool* Pool = Pools.Find(ProjectileClass);
+	if ( !Pool )
+	{
+		Pool = &Pools.Add(ProjectileClass);
+		Pool->MaxInactive = UWeaponSettings::Get()->GetProjectilePoolSize(ProjectileClass);
+		Pool->Inactive.Reserve(Pool->MaxInactive);
+	}
+
+	return *Pool;
+}
+
+AMortalCryProjectile* UProjectilePoolSubsystem::SpawnInstance(TSubclassOf<AMortalCryProjectile> ProjectileClass, const FTransform& SpawnTransform,
+	AActor* Owner, APawn* Instigator) const
+{
+	// deferred, so BeginPlay already sees it as pooled and leaves the activation to the pool
+	AMortalCryProjectile* Projectile = GetWorld()->SpawnActorDeferred<AMortalCryProjectile>(ProjectileClass, SpawnTransform, Owner, Instigator,
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if ( Projectile )
+	{
+		Projectile->SetFlags(RF_Transient);
+		Projectile->SetPooled();
+		Projectile->FinishSpawning(SpawnTransform);
+	}
+
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::PreallocateProjectiles(TSubclassOf<AMortalCryProjectile> ProjectileClass)
+{
+	if ( !ProjectileClass )
+	{
+		return;
+	}
+
+	FProjectilePool& Pool = GetPool(ProjectileClass);
+	while ( Pool.Inactive.Num() < Pool.MaxInactive )
+	{
+		AMortalCryProjectile* Projectile = SpawnInstance(ProjectileClass, FTransform::Identity, nullptr, nullptr);
+		if ( !Projectile )
+		{
+			return;
+		}
+
+		Pool.Inactive.Add(Projectile);
+	}
+}
+
+AMortalCryProjectile* UProjectilePoolSubsystem::FireProjectile(TSubclassOf<AMortalCryProjectile> ProjectileClass, const FVector& Location,
+	const FRotator& Rotation, AActor* Owner, APawn* Instigator)
+{
+	if ( !ProjectileClass )
+	{
+		return nullptr;
+	}
+
+	FProjectilePool& Pool = GetPool(ProjectileClass);
+
+	AMortalCryProjectile* Projectile = nullptr;
+	while ( !Projectile && Pool.Inactive.Num() > 0 )
+	{
+		Projectile = Pool.Inactive.Pop(false);
+		if ( IsValid(Projectile) )
+		{
+			++NumSpawnsAvoided;
+		}
+		else
+		{
+			Projectile = nullptr;
+		}
+	}
+
+	if ( !Projectile )
+	{
+		Projectile = SpawnInstance(ProjectileClass, FTransform(Rotation, Location), Owner, Instigator);
+		if ( !Projectile )
+		{
+			return nullptr;
+		}
+	}
+
+	Projectile->SetOwner(Owner);
+	Projectile->SetInstigator(Instigator);
+	Projectile->ActivateProjectile(Location, Rotation);
+
+	return Projectile;
+}
+
+void UProjectilePoolSubsystem::ReleaseProjectile(AMortalCryProjectile* Projectile)
+{
+	FProjectilePool& Pool = GetPool(Projectile->GetClass());
+	if ( Pool.Inactive.Num() >= Pool.MaxInactive )
+	{
+		Projectile->Destroy();
+		return;
+	}
+
+	Projectile->SetOwner(nullptr);
+	Projectile->SetInstigator(nullptr);
+	Pool.Inactive.Add(Projectile);
+}
+
+UProjectilePoolSubsystem* UProjectilePoolSubsystem::Get(const UObject* WorldContextObject)
+{
+	const UWorld* World = WorldContextObject ? WorldContextObject->GetWorld() : nullptr;
+	return World ? World->GetSubsystem<UProjectilePoolSubsystem>() : nullptr;
+}
+
+AMortalCryProjectile* UProjectilePoolSubsystem::FirePooledProjectile(const UObject* WorldContextObject,
+	TSubclassOf<AMortalCryProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation, AActor* Owner, APawn* Instigator)
+{
+	UProjectilePoolSubsystem* Pool = Get(WorldContextObject);
+	return Pool ? Pool->FireProjectile(ProjectileClass, Location, Rotation, Owner, Instigator) : nullptr;
+}
+
+void UProjectilePoolSubsystem::PreallocatePooledProjectiles(const UObject* WorldContextObject, TSubclassOf<AMortalCryProjectile> ProjectileClass)
+{
+	if ( UProjectilePoolSubsystem* Pool = Get(WorldContextObject) )
+	{
+		Pool->PreallocateProjectiles(ProjectileClass);
+	}
+}
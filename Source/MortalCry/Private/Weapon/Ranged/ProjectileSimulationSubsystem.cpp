@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/Ranged/ProjectileSimulationSubsystem.h"
+
+#include "MortalCry.h"
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "Weapon/WeaponSettings.h"
+
+UProjectileSimulationSubsystem::UProjectileSimulationSubsystem()
+{
+	VisualsHost = nullptr;
+}
+
+int32 UProjectileSimulationSubsystem::RegisterProjectileType(const UObject* TypeKey, const FSimulatedProjectileParams& Params)
+{
+	const int32 ExistingIndex = FindProjectileType(TypeKey);
+	if ( ExistingIndex != INDEX_NONE )
+	{
+		return ExistingIndex;
+	}
+
+	check(Types.Num() < MAX_uint16);
+
+	FSimulatedProjectileType& Type = Types.AddDefaulted_GetRef();
+	Type.Params = Params;
+	Type.Visuals = CreateVisuals(Params);
+
+	const int32 TypeIndex = Types.Num() - 1;
+	if ( TypeKey )
+	{
+		TypesByKey.Add(TypeKey, TypeIndex);
+	}
+
+	return TypeIndex;
+}
+
+int32 UProjectileSimulationSubsystem::FindProjectileType(const UObject* TypeKey) const
+{
+	const int32* TypeIndex = TypeKey ? TypesByKey.Find(TypeKey) : nullptr;
+	return TypeIndex ? *TypeIndex : INDEX_NONE;
+}
+
+UInstancedStaticMeshComponent* UProjectileSimulationSubsystem::CreateVisuals(const FSimulatedProjectileParams& Params)
+{
+	if ( !Params.Mesh || GetWorld()->GetNetMode() == NM_DedicatedServer )
+	{
+		return nullptr;
+	}
+
+	if ( !VisualsHost )
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		VisualsHost = GetWorld()->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	}
+
+	UInstancedStaticMeshComponent* Visuals = NewObject<UInstancedStaticMeshComponent>(VisualsHost);
+	Visuals->SetStaticMesh(Params.Mesh);
+	Visuals->SetMobility(EComponentMobility::Movable);
+	Visuals->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Visuals->SetCastShadow(false);
+
+	if ( !VisualsHost->GetRootComponent() )
+	{
+		VisualsHost->SetRootComponent(Visuals);
+	}
+	else
+	{
+		Visuals->SetupAttachment(VisualsHost->GetRootComponent());
+	}
+
+	Visuals->RegisterComponent();
+	VisualsHost->AddInstanceComponent(Visuals);
+
+	return Visuals;
+}
+
+bool UProjectileSimulationSubsystem::FireProjectile(int32 TypeIndex, const FVector& Origin, const FVector& Direction,
+	AActor* DamageCauser, AController* InstigatorController)
+{
+	return AddProjectile(TypeIndex, Origin, Direction, DamageCauser, InstigatorController, false);
+}
+
+bool UProjectileSimulationSubsystem::FireCosmeticProjectile(int32 TypeIndex, const FVector& Origin, const FVector& Direction,
+	AActor* DamageCauser)
+{
+	// nobody would see it
+	if ( GetWorld()->GetNetMode() == NM_DedicatedServer )
+	{
+		return false;
+	}
+
+	return AddProjectile(TypeIndex, Origin, Direction, DamageCauser, nullptr, true);
+}
+
+bool UProjectileSimulationSubsystem::AddProjectile(int32 TypeIndex, const FVector& Origin, const FVector& Direction,
+	AActor* DamageCauser, AController* InstigatorController, bool bIsCosmetic)
+{
+	if ( !Types.IsValidIndex(TypeIndex) || Locations.Num() >= UWeaponSettings::Get()->MaxSimulatedProjectiles )
+	{
+		return false;
+	}
+
+	const FSimulatedProjectileParams& Params = Types[TypeIndex].Params;
+
+	// a bullet leaving the muzzle must not hit the pawn holding the weapon
+	const APawn* InstigatorPawn = DamageCauser ? DamageCauser->GetInstigator() : nullptr;
+	if ( !InstigatorPawn && InstigatorController )
+	{
+		InstigatorPawn = InstigatorController->GetPawn();
+	}
+
+	Locations.Add(Origin);
+	Velocities.Add(Direction.GetSafeNormal() * Params.InitialSpeed);
+	RemainingLives.Add(Params.LifeSpan);
+	TypeIndices.Add(static_cast<uint16>(TypeIndex));
+	IgnoredActorIds.Add(DamageCauser ? DamageCauser->GetUniqueID() : 0);
+	IgnoredInstigatorIds.Add(InstigatorPawn ? InstigatorPawn->GetUniqueID() : 0);
+	bCosmetic.Add(bIsCosmetic);
+	DamageCausers.Add(DamageCauser);
+	InstigatorControllers.Add(InstigatorController);
+
+	return true;
+}
+
+void UProjectileSimulationSubsystem::Simulate(float DeltaTime)
+{
+	const int32 NumProjectiles = Locations.Num();
+
+	NextLocations.SetNumUninitialized(NumProjectiles, false);
+	Hits.Reset(NumProjectiles);
+	Hits.SetNum(NumProjectiles);
+	bBlockingHits.SetNumUninitialized(NumProjectiles, false);
+
+	UWorld* World = GetWorld();
+	const FVector Gravity(0.f, 0.f, World->GetGravityZ());
+
+	// every projectile only reads the physics scene and writes its own slots
+	ParallelFor(NumProjectiles, [this, World, &Gravity, DeltaTime](int32 Index)
+	{
+		const FSimulatedProjectileParams& Params = Types[TypeIndices[Index]].Params;
+		const FVector Acceleration = Gravity * Params.GravityScale;
+
+		FVector& Velocity = Velocities[Index];
+		NextLocations[Index] = Locations[Index] + Velocity * DeltaTime + 0.5f * Acceleration * DeltaTime * DeltaTime;
+		Velocity += Acceleration * DeltaTime;
+		RemainingLives[Index] -= DeltaTime;
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(SimulatedProjectile), false);
+		if ( IgnoredActorIds[Index] != 0 )
+		{
+			QueryParams.AddIgnoredActor(IgnoredActorIds[Index]);
+		}
+		if ( IgnoredInstigatorIds[Index] != 0 )
+		{
+			QueryParams.AddIgnoredActor(IgnoredInstigatorIds[Index]);
+		}
+
+		bBlockingHits[Index] = World->SweepSingleByChannel(Hits[Index], Locations[Index], NextLocations[Index], FQuat::Identity,
+			Params.TraceChannel, FCollisionShape::MakeSphere(Params.Radius), QueryParams);
+	}, NumProjectiles < MinParallelBatchSize);
+
+	// damage runs game code, so hits are applied here in order, removing from the back keeps pending indices valid
+	for (int32 Index = NumProjectiles - 1; Index >= 0; --Index)
+	{
+		if ( bBlockingHits[Index] )
+		{
+			if ( !bCosmetic[Index] )
+			{
+				ApplyHit(Index);
+			}
+			RemoveProjectile(Index);
+		}
+		else if ( RemainingLives[Index] <= 0.f )
+		{
+			RemoveProjectile(Index);
+		}
+		else
+		{
+			Locations[Index] = NextLocations[Index];
+		}
+	}
+}
+
+void UProjectileSimulationSubsystem::ApplyHit(int32 Index)
+{
+	const FHitResult& Hit = Hits[Index];
+	AActor* HitActor = Hit.GetActor();
+	if ( !HitActor )
+	{
+		return;
+	}
+
+	const FSimulatedProjectileParams& Params = Types[TypeIndices[Index]].Params;
+
+	UPrimitiveComponent* HitComponent = Hit.GetComponent();
+	if ( HitComponent && HitComponent->IsSimulatingPhysics() )
+	{
+		HitComponent->AddImpulseAtLocation(Velocities[Index] * Params.ImpulseScale, Hit.ImpactPoint);
+	}
+
+	if ( HitActor->CanBeDamaged() )
+	{
+		FPointDamageEvent DamageEvent;
+		DamageEvent.Damage = Params.Damage;
+		DamageEvent.HitInfo = Hit;
+		DamageEvent.ShotDirection = Velocities[Index].GetSafeNormal();
+		if ( Params.DamageType )
+		{
+			DamageEvent.DamageTypeClass = Params.DamageType;
+		}
+
+		HitActor->TakeDamage(Params.Damage, DamageEvent, InstigatorControllers[Index].Get(), DamageCausers[Index].Get());
+	}
+}
+
+void UProjectileSimulationSubsystem::RemoveProjectile(int32 Index)
+{
+	Locations.RemoveAtSwap(Index, 1, false);
+	Velocities.RemoveAtSwap(Index, 1, false);
+	RemainingLives.RemoveAtSwap(Index, 1, false);
+	TypeIndices.RemoveAtSwap(Index, 1, false);
+	IgnoredActorIds.RemoveAtSwap(Index, 1, false);
+	IgnoredInstigatorIds.RemoveAtSwap(Index, 1, false);
+	bCosmetic.RemoveAtSwap(Index, 1, false);
+	DamageCausers.RemoveAtSwap(Index, 1, false);
+	InstigatorControllers.RemoveAtSwap(Index, 1, false);
+}
+
+void UProjectileSimulationSubsystem::UpdateVisuals()
+{
+	for (FSimulatedProjectileType& Type : Types)
+	{
+		Type.InstanceTransforms.Reset();
+	}
+
+	for (int32 Index = 0; Index < Locations.Num(); ++Index)
+	{
+		FSimulatedProjectileType& Type = Types[TypeIndices[Index]];
+		if ( Type.Visuals )
+		{
+			Type.InstanceTransforms.Emplace(Velocities[Index].Rotation(), Locations[Index], Type.Params.MeshScale);
+		}
+	}
+
+	for (FSimulatedProjectileType& Type : Types)
+	{
+		UInstancedStaticMeshComponent* Visuals = Type.Visuals;
+		if ( !Visuals )
+		{
+			continue;
+		}
+
+		// instances are interchangeable, so only the count changes and every transform is rewritten
+		const int32 NumInstances = Type.InstanceTransforms.Num();
+		while ( Visuals->GetInstanceCount() > NumInstances )
+		{
+			Visuals->RemoveInstance(Visuals->GetInstanceCount() - 1);
+		}
+
+		while ( Visuals->GetInstanceCount() < NumInstances )
+		{
+			Visuals->AddInstance(FTransform::Identity);
+		}
+
+		if ( NumInstances > 0 )
+		{
+			Visuals->BatchUpdateInstancesTransforms(0, Type.InstanceTransforms, true, true, true);
+		}
+	}
+}
+
+void UProjectileSimulationSubsystem::Deinitialize()
+{
+	if ( VisualsHost )
+	{
+		VisualsHost->Destroy();
+		VisualsHost = nullptr;
+	}
+
+	Types.Reset();
+	TypesByKey.Reset();
+
+	Super::Deinitialize();
+}
+
+void UProjectileSimulationSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponProjectileSimulation);
+	CSV_SCOPED_TIMING_STAT(MortalCryWeapons, ProjectileSimulation);
+
+	Simulate(DeltaTime);
+	UpdateVisuals();
+
+	SET_DWORD_STAT(STAT_WeaponSimulatedProjectiles, Locations.Num());
+}
+
+bool UProjectileSimulationSubsystem::IsTickable() const
+{
+	// the frame that removes the last projectile still ticks and clears its instance
+	return Locations.Num() > 0;
+}
+
+ETickableTickType UProjectileSimulationSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UProjectileSimulationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSimulationSubsystem, STATGROUP_Tickables);
+}
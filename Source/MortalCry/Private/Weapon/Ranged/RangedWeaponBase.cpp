@@ -3,6 +3,7 @@
 
 #include "Weapon/Ranged/RangedWeaponBase.h"
 
+#include "MortalCry.h"
 #include "AIController.h"
 #include "Components/AudioComponent.h"
 #include "Kismet/GameplayStatics.h"
@@ -15,11 +16,20 @@ typedef ERangedWeaponState::Type EWeaponState;
 
 ARangedWeaponBase::ARangedWeaponBase(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
+	// only ticks while a burst is running
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickGroup = TG_PrePhysics;
+
 	bWantsToFire = false;
 	bPendingReload = false;
 	AmmoInClip = 0;
 	BurstCounter = 0;
+	FireTimeAccumulator = 0.f;
+	ReloadPredictionId = 0;
 	CurrentState = EWeaponState::Idle;
+	EffectPoolBudget = 8;
+	NextPooledEffect = 0;
 }
 
 void ARangedWeaponBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -91,36 +101,79 @@ void ARangedWeaponBase::SetWeaponState(EWeaponState NewState)
 
 void ARangedWeaponBase::OnBurstStarted()
 {
+	FireTimeAccumulator = 0.f;
+
 	HandleFiring();
+
+	if ( CurrentState == EWeaponState::Firing && RangedWeaponConfig.TimeBetweenShots > 0.0f )
+	{
+		SetActorTickEnabled(true);
+	}
 }
 
 void ARangedWeaponBase::OnBurstFinished()
 {
 	StopSimulatingWeaponFire();
-	GetWorldTimerManager().ClearTimer(TimerHandle_HandleFiring);
+
+	SetActorTickEnabled(false);
+	FireTimeAccumulator = 0.f;
 }
 
-void ARangedWeaponBase::UseAmmo()
+void ARangedWeaponBase::Tick(float DeltaSeconds)
 {
-	if ( !HasInfiniteClip() )
+	Super::Tick(DeltaSeconds);
+
+	const float TimeBetweenShots = RangedWeaponConfig.TimeBetweenShots;
+	if ( CurrentState != EWeaponState::Firing || TimeBetweenShots <= 0.0f )
 	{
-		AmmoInClip--;
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	// keep the remainder, so the fire rate does not depend on the frame rate
+	FireTimeAccumulator += DeltaSeconds;
+
+	// shots due this frame are fired back to back, their traces go out together in the next trace batch,
+	// the burst finishing disables the tick and ends the loop so it is not finished again for every shot left
+	int32 NumShots = 0;
+	while ( FireTimeAccumulator >= TimeBetweenShots && NumShots < RangedWeaponConfig.MaxShotsPerTick && CurrentState == EWeaponState::Firing
+		&& PrimaryActorTick.IsTickFunctionEnabled() )
+	{
+		FireTimeAccumulator -= TimeBetweenShots;
+		++NumShots;
+
+		HandleFiring();
+	}
+
+	if ( NumShots == RangedWeaponConfig.MaxShotsPerTick )
+	{
+		FireTimeAccumulator = FMath::Min(FireTimeAccumulator, TimeBetweenShots);
 	}
 }
 
-void ARangedWeaponBase::HandleReFiring()
+void ARangedWeaponBase::UseAmmo()
 {
-	HandleFiring();
+	if ( !HasInfiniteClip() )
+	{
+		AmmoInClip--;
+	}
 }
 
-bool ARangedWeaponBase::ServerHandleFiring_Validate()
+bool ARangedWeaponBase::ServerHandleFiring_Validate(uint16 ShotIndex)
 {
 	return true;
 }
 
-void ARangedWeaponBase::ServerHandleFiring_Implementation()
+void ARangedWeaponBase::ServerHandleFiring_Implementation(uint16 ShotIndex)
 {
+	SCOPE_CYCLE_COUNTER(STAT_WeaponRPCReceive);
+	CSV_SCOPED_TIMING_STAT(MortalCryWeapons, RPCReceive);
+
 	const bool bShouldUpdateAmmo = AmmoInClip > 0 && CanFire();
+	if (bShouldUpdateAmmo)
+	{
+		RecordServerShot(ShotIndex);
+	}
 
 	HandleFiring();
 
@@ -142,7 +195,7 @@ void ARangedWeaponBase::SimulateWeaponFire()
 	if ( MuzzleFX )
 	{
 		USkeletalMeshComponent* UseWeaponMesh = GetWeaponMesh();
-		if ( !bLoopedMuzzleFX || !MuzzlePSC )
+		if ( !bLoopedMuzzleFX || !MuzzlePSC || !MuzzlePSC->IsActive() )
 		{
 			// Split screen requires we create 2 effects. One that we see and one that the other player sees.
 			if( GetMyPawn() && GetMyPawn()->IsLocallyControlled() )
@@ -150,20 +203,24 @@ void ARangedWeaponBase::SimulateWeaponFire()
 				AController* PlayerCon = GetMyPawn()->GetController();				
 				if( PlayerCon )
 				{
-					//GetMeshFP()->GetSocketLocation(MuzzleAttachPoint);
-					MuzzlePSC = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, GetMeshFP(), MuzzleAttachPoint);
-					MuzzlePSC->bOwnerNoSee = false;
-					MuzzlePSC->bOnlyOwnerSee = true;
-
-					//GetMeshTP()->GetSocketLocation(MuzzleAttachPoint);
-					MuzzlePSCSecondary = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, GetMeshTP(), MuzzleAttachPoint);
-					MuzzlePSCSecondary->bOwnerNoSee = true;
-					MuzzlePSCSecondary->bOnlyOwnerSee = false;				
+					MuzzlePSC = ActivateMuzzleFX(MuzzlePSC, GetMeshFP());
+					if ( MuzzlePSC )
+					{
+						MuzzlePSC->bOwnerNoSee = false;
+						MuzzlePSC->bOnlyOwnerSee = true;
+					}
+
+					MuzzlePSCSecondary = ActivateMuzzleFX(MuzzlePSCSecondary, GetMeshTP());
+					if ( MuzzlePSCSecondary )
+					{
+						MuzzlePSCSecondary->bOwnerNoSee = true;
+						MuzzlePSCSecondary->bOnlyOwnerSee = false;
+					}
 				}				
 			}
 			else
 			{
-				MuzzlePSC = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, UseWeaponMesh, MuzzleAttachPoint);
+				MuzzlePSC = ActivateMuzzleFX(MuzzlePSC, UseWeaponMesh);
 			}
 		}
 	}
@@ -204,19 +261,69 @@ void ARangedWeaponBase::SimulateWeaponFire()
 	}
 }
 
+UParticleSystemComponent* ARangedWeaponBase::ActivateMuzzleFX(UParticleSystemComponent* MuzzleComponent, USkeletalMeshComponent* Mesh) const
+{
+	if ( MuzzleComponent && MuzzleComponent->GetAttachParent() == Mesh )
+	{
+		MuzzleComponent->ActivateSystem(true);
+		return MuzzleComponent;
+	}
+
+	if ( MuzzleComponent )
+	{
+		MuzzleComponent->DestroyComponent();
+	}
+
+	return UGameplayStatics::SpawnEmitterAttached(MuzzleFX, Mesh, MuzzleAttachPoint, FVector::ZeroVector, FRotator::ZeroRotator,
+		EAttachLocation::KeepRelativeOffset, false);
+}
+
+UParticleSystemComponent* ARangedWeaponBase::AcquirePooledEffect(UParticleSystem* Template)
+{
+	for ( UParticleSystemComponent* PooledEffect : PooledEffects )
+	{
+		if ( !PooledEffect->IsActive() )
+		{
+			PooledEffect->SetTemplate(Template);
+			return PooledEffect;
+		}
+	}
+
+	if ( PooledEffects.Num() < EffectPoolBudget )
+	{
+		UParticleSystemComponent* PooledEffect = NewObject<UParticleSystemComponent>(this, NAME_None, RF_Transient);
+		PooledEffect->bAutoActivate = false;
+		PooledEffect->bAutoDestroy = false;
+		PooledEffect->SetUsingAbsoluteLocation(true);
+		PooledEffect->SetUsingAbsoluteRotation(true);
+		PooledEffect->SetTemplate(Template);
+		PooledEffect->RegisterComponent();
+
+		PooledEffects.Add(PooledEffect);
+		return PooledEffect;
+	}
+
+	// over budget, restart the oldest effect rather than growing the pool
+	UParticleSystemComponent* OldestEffect = PooledEffects[NextPooledEffect];
+	NextPooledEffect = (NextPooledEffect + 1) % PooledEffects.Num();
+
+	OldestEffect->DeactivateImmediate();
+	OldestEffect->SetTemplate(Template);
+	return OldestEffect;
+}
+
 void ARangedWeaponBase::StopSimulatingWeaponFire()
 {
 	if (bLoopedMuzzleFX )
 	{
+		// keep the components, the next burst reactivates them
 		if( MuzzlePSC != NULL )
 		{
 			MuzzlePSC->DeactivateSystem();
-			MuzzlePSC = NULL;
 		}
 		if( MuzzlePSCSecondary != NULL )
 		{
 			MuzzlePSCSecondary->DeactivateSystem();
-			MuzzlePSCSecondary = NULL;
 		}
 	}
 
@@ -237,6 +344,10 @@ void ARangedWeaponBase::StopSimulatingWeaponFire()
 
 void ARangedWeaponBase::HandleFiring()
 {
+	SCOPE_CYCLE_COUNTER(STAT_WeaponFire);
+	CSV_SCOPED_TIMING_STAT(MortalCryWeapons, Fire);
+
+	const int32 ShotIndex = BurstCounter;
 	if ( AmmoInClip > 0 && CanFire() )
 	{
 		if (GetNetMode() != NM_DedicatedServer)
@@ -248,11 +359,9 @@ void ARangedWeaponBase::HandleFiring()
 		UseAmmo();
 
 		BurstCounter++;
-		
-		if ( CurrentState == EWeaponState::Firing && RangedWeaponConfig.TimeBetweenShots > 0.0f )
-		{
-			GetWorldTimerManager().SetTimer(TimerHandle_HandleFiring, this, &ARangedWeaponBase::HandleReFiring, RangedWeaponConfig.TimeBetweenShots, false);
-		}
+
+		INC_DWORD_STAT(STAT_WeaponShotsFired);
+		CSV_CUSTOM_STAT(MortalCryWeapons, ShotsFired, 1, ECsvCustomStatOp::Accumulate);
 	}
 	else if ( CanReload() )
 	{
@@ -267,7 +376,8 @@ void ARangedWeaponBase::HandleFiring()
 	{
 		if ( GetLocalRole() < ROLE_Authority )
 		{
-			ServerHandleFiring();
+			SCOPE_CYCLE_COUNTER(STAT_WeaponRPCSend);
+			ServerHandleFiring(static_cast<uint16>(ShotIndex));
 		}
 
 		if ( AmmoInClip <= 0 && CanReload() )
@@ -277,14 +387,21 @@ void ARangedWeaponBase::HandleFiring()
 	}
 }
 
-bool ARangedWeaponBase::ServerStartReload_Validate()
+bool ARangedWeaponBase::ServerStartReload_Validate(int32 PredictionId)
 {
 	return true;
 }
 
-void ARangedWeaponBase::ServerStartReload_Implementation()
+void ARangedWeaponBase::ServerStartReload_Implementation(int32 PredictionId)
 {
 	StartReload();
+
+	// a refused reload is acked now so the client gets its ammo back, unless one in flight will ack it
+	ReloadPredictionId = FMath::Max(ReloadPredictionId, PredictionId);
+	if ( !bPendingReload )
+	{
+		AckReloadPrediction();
+	}
 }
 
 bool ARangedWeaponBase::ServerStopReload_Validate()
@@ -299,19 +416,34 @@ void ARangedWeaponBase::ServerStopReload_Implementation()
 
 bool ARangedWeaponBase::CanReload() const
 {
-	const bool bGotAmmo = AmmoInClip < RangedWeaponConfig.ClipSize && (GetMyPawn()->GetInventory()->Contains(RangedWeaponConfig.AmmoClass) || HasInfiniteAmmo());
+	// the ammo this reload already took on the owning client still counts as reserve, or the last magazine could never reload
+	const UInventoryComponent* Inventory = GetMyPawn()->GetInventory();
+	const int32 ReserveAmmo = Inventory->GetAmount(RangedWeaponConfig.AmmoClass) - Inventory->GetPendingAmount(ReloadPredictionId);
+	const bool bGotAmmo = AmmoInClip < RangedWeaponConfig.ClipSize && (ReserveAmmo > 0 || HasInfiniteAmmo());
 	const bool bStateOKToReload = CurrentState < EWeaponState::Reloading;
 	return bGotAmmo && bStateOKToReload;
 }
 
 void ARangedWeaponBase::StartReload(bool bFromReplication)
 {
+	const bool bCanReload = CanReload();
+
 	if ( !bFromReplication && GetLocalRole() < ROLE_Authority )
 	{
-		ServerStartReload();
+		// the ammo leaves the inventory now, so reload checks don't wait a round trip for the server's count
+		int32 PredictionId = 0;
+		if ( bCanReload && !HasInfiniteAmmo() )
+		{
+			const int32 ClipDelta = RangedWeaponConfig.ClipSize - AmmoInClip;
+			UInventoryComponent* Inventory = GetMyPawn()->GetInventory();
+			PredictionId = Inventory->PredictChange(RangedWeaponConfig.AmmoClass, -FMath::Min(ClipDelta, Inventory->GetAmount(RangedWeaponConfig.AmmoClass)), true);
+			ReloadPredictionId = PredictionId;
+		}
+
+		ServerStartReload(PredictionId);
 	}
 
-	if (bFromReplication || CanReload())
+	if (bFromReplication || bCanReload)
 	{
 		bPendingReload = true;
 		DetermineWeaponState();
@@ -338,6 +470,12 @@ void ARangedWeaponBase::StopReload()
 		bPendingReload = false;
 		DetermineWeaponState();
 	}
+
+	// the server acks its own copy in ReloadWeapon
+	if (GetLocalRole() < ROLE_Authority)
+	{
+		ReloadPredictionId = 0;
+	}
 }
 
 void ARangedWeaponBase::ReloadWeapon()
@@ -345,6 +483,7 @@ void ARangedWeaponBase::ReloadWeapon()
 	if ( HasInfiniteAmmo() )
 	{
 		AmmoInClip = RangedWeaponConfig.ClipSize;
+		AckReloadPrediction();
 		return;
 	}
 
@@ -355,6 +494,18 @@ void ARangedWeaponBase::ReloadWeapon()
 	{
 		AmmoInClip += StoredAmmo;
 	}
+
+	AckReloadPrediction();
+}
+
+void ARangedWeaponBase::AckReloadPrediction()
+{
+	if ( ReloadPredictionId != 0 && GetMyPawn() )
+	{
+		GetMyPawn()->GetInventory()->AckDeferredPrediction(ReloadPredictionId);
+	}
+
+	ReloadPredictionId = 0;
 }
 
 void ARangedWeaponBase::StartFire()
@@ -385,6 +536,13 @@ void ARangedWeaponBase::StopFire()
 	}
 }
 
+void ARangedWeaponBase::ForceInfiniteAmmo()
+{
+	RangedWeaponConfig.bInfiniteAmmo = true;
+	RangedWeaponConfig.bInfiniteClip = true;
+	AmmoInClip = FMath::Max(AmmoInClip, RangedWeaponConfig.ClipSize);
+}
+
 bool ARangedWeaponBase::CanFire() const
 {
 	return CurrentState < EWeaponState::Reloading && bPendingReload == false;
@@ -3,138 +3,400 @@
 
 #include "Weapon/Ranged/RangedWeapon_Instant.h"
 
+#include "MortalCry.h"
+#include "Camera/PlayerCameraManager.h"
+#include "GameFramework/PlayerController.h"
 #include "Kismet/GameplayStatics.h"
 #include "Net/UnrealNetwork.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "Weapon/Ranged/ImpactEffect.h"
+#include "Weapon/Ranged/ImpactEffectSubsystem.h"
 
 ARangedWeapon_Instant::ARangedWeapon_Instant(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
 {
 	CurrentFiringSpread = 0.f;
+	PendingHitsTimestamp = 0.f;
+	LastSimulatedShot = 0;
+	ShotSeedBase = 0;
+	LastVerifiedShotIndex = INDEX_NONE;
+	TrailCullDistance = 5000.f;
+
+	for (FInstantServerShot& Shot : ServerShots)
+	{
+		Shot.bValid = false;
+	}
+}
+
+void ARangedWeapon_Instant::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (GetLocalRole() == ROLE_Authority)
+	{
+		ShotSeedBase = FMath::Rand();
+	}
+
+	// get surface specific impact assets loading before the first shot lands
+	if (ImpactTemplate && GetNetMode() != NM_DedicatedServer)
+	{
+		if (UImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UImpactEffectSubsystem>())
+		{
+			ImpactEffects->PreloadImpact(ImpactTemplate);
+		}
+	}
 }
 
 void ARangedWeapon_Instant::Fire()
 {
-	const int32 RandomSeed = FMath::Rand();
-	const FRandomStream WeaponRandomStream(RandomSeed);
+	// the server regenerates the same shot from its index
+	const int32 ShotIndex = GetBurstCounter();
+	const int32 RandomSeed = GetShotSeed(ShotIndex);
 	const float CurrentSpread = GetCurrentSpread();
-	const float ConeHalfAngle = FMath::DegreesToRadians(CurrentSpread * 0.5f);
 
 	const FVector AimDir = GetAdjustedAim();
 	const FVector StartTrace = GetCameraDamageStartLocation(AimDir);
-	const FVector ShootDir = WeaponRandomStream.VRandCone(AimDir, ConeHalfAngle, ConeHalfAngle);
+	const FVector ShootDir = GetShotDirection(AimDir, RandomSeed, CurrentSpread);
 	const FVector EndTrace = StartTrace + ShootDir * InstantConfig.WeaponRange;
 
-	const FHitResult Impact = WeaponTrace(StartTrace, EndTrace);
-	ProcessInstantHit(Impact, StartTrace, ShootDir, RandomSeed, CurrentSpread);
+	RequestWeaponTrace(StartTrace, EndTrace,
+		FWeaponTraceDelegate::CreateUObject(this, &ARangedWeapon_Instant::OnFireTraced, StartTrace, ShootDir, ShotIndex, CurrentSpread));
 	
 	CurrentFiringSpread = FMath::Min(InstantConfig.FiringSpreadMax, CurrentFiringSpread + InstantConfig.FiringSpreadIncrement);
 }
 
-FHitResult ARangedWeapon_Instant::WeaponTrace(const FVector& StartTrace, const FVector& EndTrace)
+void ARangedWeapon_Instant::OnFireTraced(const FHitResult& Impact, FVector Origin, FVector ShootDir, int32 ShotIndex,
+	float ReticleSpread)
+{
+	ProcessInstantHit(Impact, Origin, ShootDir, ShotIndex, ReticleSpread);
+}
+
+int32 ARangedWeapon_Instant::GetShotSeed(int32 ShotIndex) const
+{
+	// seeds travel as 16 bits in the shot history
+	return HashCombine(static_cast<uint32>(ShotSeedBase), static_cast<uint32>(ShotIndex)) & MAX_uint16;
+}
+
+FVector ARangedWeapon_Instant::GetShotDirection(const FVector& AimDir, int32 RandomSeed, float ReticleSpread) const
+{
+	const FRandomStream WeaponRandomStream(RandomSeed);
+	const float ConeHalfAngle = FMath::DegreesToRadians(ReticleSpread * 0.5f);
+
+	return WeaponRandomStream.VRandCone(AimDir, ConeHalfAngle, ConeHalfAngle);
+}
+
+bool ARangedWeapon_Instant::AcceptShotIndex(uint16 ShotIndexBits, int32& OutShotIndex)
+{
+	// take the first index after the last accepted one that ends in the notified bits
+	const int32 LastShotIndex = FMath::Max(LastVerifiedShotIndex, 0);
+	int32 ShotIndex = (LastShotIndex & ~static_cast<int32>(MAX_uint16)) | ShotIndexBits;
+	if (ShotIndex <= LastVerifiedShotIndex)
+	{
+		ShotIndex += MAX_uint16 + 1;
+	}
+
+	// replayed or wildly out of sequence
+	if (ShotIndex - LastShotIndex > MAX_uint16 / 2)
+	{
+		return false;
+	}
+
+	LastVerifiedShotIndex = ShotIndex;
+	OutShotIndex = ShotIndex;
+	return true;
+}
+
+void ARangedWeapon_Instant::RecordServerShot(uint16 ShotIndex)
+{
+	// taken before the server fires its own copy, which grows the firing spread the same way the client's shot did
+	FInstantServerShot& Shot = ServerShots[ShotIndex % NumServerShots];
+	Shot.ViewLocation = GetInstigator() ? GetInstigator()->GetPawnViewLocation() : GetMuzzleLocation();
+	Shot.AimDir = GetInstigator() ? GetInstigator()->GetBaseAimRotation().Vector() : GetAdjustedAim();
+	Shot.ReticleSpread = GetCurrentSpread();
+	Shot.ShotIndex = ShotIndex;
+	Shot.bValid = true;
+}
+
+const FInstantServerShot* ARangedWeapon_Instant::ConsumeServerShot(uint16 ShotIndexBits)
+{
+	FInstantServerShot& Shot = ServerShots[ShotIndexBits % NumServerShots];
+	if (!Shot.bValid || Shot.ShotIndex != ShotIndexBits)
+	{
+		return nullptr;
+	}
+
+	Shot.bValid = false;
+	return &Shot;
+}
+
+FCollisionQueryParams ARangedWeapon_Instant::GetWeaponTraceParams() const
 {
 	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(WeaponTrace), true, GetMyPawn());
 	TraceParams.bReturnPhysicalMaterial = true;
 
+	return TraceParams;
+}
+
+FHitResult ARangedWeapon_Instant::WeaponTrace(const FVector& StartTrace, const FVector& EndTrace)
+{
 	FHitResult Hit(ForceInit);
-	GetWorld()->LineTraceSingleByChannel(Hit, StartTrace, EndTrace, ECC_GameTraceChannel1, TraceParams);
+	GetWorld()->LineTraceSingleByChannel(Hit, StartTrace, EndTrace, ECC_GameTraceChannel1, GetWeaponTraceParams());
 
 	return Hit;
 }
 
-bool ARangedWeapon_Instant::ServerNotifyHit_Validate(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir,
-	int32 RandomSeed, float ReticleSpread)
+void ARangedWeapon_Instant::RequestWeaponTrace(const FVector& StartTrace, const FVector& EndTrace,
+	FWeaponTraceDelegate&& OnTraced)
 {
-	return true;
+	if ( UWeaponTraceSubsystem* TraceSubsystem = GetWorld()->GetSubsystem<UWeaponTraceSubsystem>() )
+	{
+		TraceSubsystem->RequestTrace(StartTrace, EndTrace, ECC_GameTraceChannel1, GetWeaponTraceParams(), MoveTemp(OnTraced));
+		return;
+	}
+
+	OnTraced.ExecuteIfBound(WeaponTrace(StartTrace, EndTrace));
+}
+
+void ARangedWeapon_Instant::QueueHitNotify(const FHitResult& Impact, int32 ShotIndex)
+{
+	const float Timestamp = UHitboxHistoryComponent::GetTimestamp(GetWorld());
+	if (PendingHitRecords.Num() == 0)
+	{
+		PendingHitsTimestamp = Timestamp;
+
+		// one notify per net update of the owner
+		const float UpdateFrequency = GetMyPawn() ? GetMyPawn()->NetUpdateFrequency : NetUpdateFrequency;
+		const float FlushDelay = FMath::Min(1.f / FMath::Max(UpdateFrequency, 4.f), 0.25f);
+		GetWorldTimerManager().SetTimer(TimerHandle_FlushHitNotifies, this, &ARangedWeapon_Instant::FlushHitNotifies, FlushDelay, false);
+	}
+
+	FInstantHitRecord& Record = PendingHitRecords.AddDefaulted_GetRef();
+	Record.HitActor = Impact.GetActor();
+	Record.ImpactPoint = Impact.ImpactPoint;
+	Record.ImpactNormal = Impact.ImpactNormal;
+	Record.ShotIndex = static_cast<uint16>(ShotIndex);
+	Record.TimestampOffset = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt((Timestamp - PendingHitsTimestamp) * 1000.f), 0, 255));
+	Record.bBlockingHit = Impact.bBlockingHit;
+
+	if (PendingHitRecords.Num() >= MaxHitsPerNotify)
+	{
+		FlushHitNotifies();
+	}
 }
 
-void ARangedWeapon_Instant::ServerNotifyHit_Implementation(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir,
-	int32 RandomSeed, float ReticleSpread)
+void ARangedWeapon_Instant::FlushHitNotifies()
 {
+	GetWorldTimerManager().ClearTimer(TimerHandle_FlushHitNotifies);
+
+	if (PendingHitRecords.Num() > 0)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_WeaponRPCSend);
+		CSV_SCOPED_TIMING_STAT(MortalCryWeapons, RPCSend);
+
+		INC_DWORD_STAT_BY(STAT_WeaponHitsSent, PendingHitRecords.Num());
+		CSV_CUSTOM_STAT(MortalCryWeapons, HitsSent, PendingHitRecords.Num(), ECsvCustomStatOp::Accumulate);
+
+		ServerNotifyHits(PendingHitRecords, PendingHitsTimestamp);
+		PendingHitRecords.Reset();
+	}
+}
+
+bool ARangedWeapon_Instant::ServerNotifyHits_Validate(const TArray<FInstantHitRecord>& Hits, float BaseTimestamp)
+{
+	return Hits.Num() <= MaxHitsPerNotify;
+}
+
+void ARangedWeapon_Instant::ServerNotifyHits_Implementation(const TArray<FInstantHitRecord>& Hits, float BaseTimestamp)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponRPCReceive);
+	CSV_SCOPED_TIMING_STAT(MortalCryWeapons, RPCReceive);
+
+	INC_DWORD_STAT_BY(STAT_WeaponHitsReceived, Hits.Num());
+	CSV_CUSTOM_STAT(MortalCryWeapons, HitsReceived, Hits.Num(), ECsvCustomStatOp::Accumulate);
+
+	const FVector Origin = GetMuzzleLocation();
+
+	for (const FInstantHitRecord& Record : Hits)
+	{
+		// the shot must have reached the server, whose view and spread at that moment regenerate its direction
+		const FInstantServerShot* Shot = ConsumeServerShot(Record.ShotIndex);
+
+		int32 ShotIndex = 0;
+		if (!Shot || !AcceptShotIndex(Record.ShotIndex, ShotIndex))
+		{
+			//UE_LOG(LogShooterWeapon, Log, TEXT("%s Rejected client shot (unknown shot index)"), *GetNameSafe(this));
+			INC_DWORD_STAT(STAT_WeaponHitsRejected);
+			CSV_CUSTOM_STAT(MortalCryWeapons, HitsRejected, 1, ECsvCustomStatOp::Accumulate);
+			continue;
+		}
+
+		const float ReticleSpread = Shot->ReticleSpread;
+		const int32 RandomSeed = GetShotSeed(ShotIndex);
+		const FVector ShootDir = GetShotDirection(Shot->AimDir, RandomSeed, ReticleSpread);
+
+		if (Record.HitActor || Record.bBlockingHit)
+		{
+			const float ShotDistance = FVector::Dist(Record.ImpactPoint, Shot->ViewLocation);
+			const float AllowedDistance = InstantConfig.ShotPathLeeway + ShotDistance * InstantConfig.ShotPathLeewayPerDistance;
+			if (FMath::PointDistToLine(Record.ImpactPoint, ShootDir, Shot->ViewLocation) > AllowedDistance)
+			{
+				//UE_LOG(LogShooterWeapon, Log, TEXT("%s Rejected client side hit of %s (off the shot line)"), *GetNameSafe(this), *GetNameSafe(Record.HitActor));
+				INC_DWORD_STAT(STAT_WeaponHitsRejected);
+				CSV_CUSTOM_STAT(MortalCryWeapons, HitsRejected, 1, ECsvCustomStatOp::Accumulate);
+				continue;
+			}
+
+			const float ClientTimestamp = BaseTimestamp + Record.TimestampOffset / 1000.f;
+			VerifyClientHit(RebuildHitResult(Record, Origin, ShootDir), *Shot, ShootDir, RandomSeed, ClientTimestamp);
+		}
+		else
+		{
+			ProcessClientMiss(ShootDir, RandomSeed, ReticleSpread);
+		}
+	}
+}
+
+FHitResult ARangedWeapon_Instant::RebuildHitResult(const FInstantHitRecord& Record, const FVector& Origin,
+	const FVector& ShootDir) const
+{
+	FHitResult Impact(ForceInit);
+	Impact.bBlockingHit = Record.bBlockingHit;
+	Impact.Actor = Record.HitActor;
+	Impact.Location = Impact.ImpactPoint = Record.ImpactPoint;
+	Impact.Normal = Impact.ImpactNormal = Record.ImpactNormal;
+	Impact.TraceStart = Origin;
+	Impact.TraceEnd = Origin + ShootDir * InstantConfig.WeaponRange;
+
+	// component, bone and physical material come from a short trace against the hit actor only
+	if (Record.HitActor)
+	{
+		const FVector StartTrace = Impact.ImpactPoint - ShootDir * 10.0f;
+		const FVector EndTrace = Impact.ImpactPoint + ShootDir * 10.0f;
+
+		FHitResult ActorHit(ForceInit);
+		if (Record.HitActor->ActorLineTraceSingle(ActorHit, StartTrace, EndTrace, ECC_GameTraceChannel1, GetWeaponTraceParams()))
+		{
+			Impact.Component = ActorHit.Component;
+			Impact.BoneName = ActorHit.BoneName;
+			Impact.PhysMaterial = ActorHit.PhysMaterial;
+		}
+	}
+
+	return Impact;
+}
+
+void ARangedWeapon_Instant::VerifyClientHit(const FHitResult& Impact, const FInstantServerShot& Shot,
+	const FVector& ShootDir, int32 RandomSeed, float ClientTimestamp)
+{
+	SCOPE_CYCLE_COUNTER(STAT_WeaponHitVerification);
+	CSV_SCOPED_TIMING_STAT(MortalCryWeapons, HitVerification);
+
+	const float ReticleSpread = Shot.ReticleSpread;
+
+	auto ConfirmHit = [this, &Impact, &ShootDir, RandomSeed, ReticleSpread]()
+	{
+		INC_DWORD_STAT(STAT_WeaponHitsVerified);
+		ProcessInstantHit_Confirmed(Impact, GetMuzzleLocation(), ShootDir, RandomSeed, ReticleSpread);
+	};
+
+	auto RejectHit = []()
+	{
+		INC_DWORD_STAT(STAT_WeaponHitsRejected);
+		CSV_CUSTOM_STAT(MortalCryWeapons, HitsRejected, 1, ECsvCustomStatOp::Accumulate);
+	};
+
 	const float WeaponAngleDot = FMath::Abs(FMath::Sin(ReticleSpread * PI / 180.f));
 
-	// if we have an instigator, calculate dot between the view and the shot
+	// if we have an instigator, calculate dot between the aim and the shot when it was fired
 	if (GetInstigator() && (Impact.GetActor() || Impact.bBlockingHit))
 	{
-		const FVector Origin = GetMuzzleLocation();
-		const FVector ViewDir = (Impact.Location - Origin).GetSafeNormal();
+		const FVector ViewDir = (Impact.Location - Shot.ViewLocation).GetSafeNormal();
 
 		// is the angle between the hit and the view within allowed limits (limit + weapon max angle)
-		const float ViewDotHitDir = FVector::DotProduct(GetInstigator()->GetViewRotation().Vector(), ViewDir);
+		const float ViewDotHitDir = FVector::DotProduct(Shot.AimDir, ViewDir);
 		if (ViewDotHitDir > InstantConfig.AllowedViewDotHitDir - WeaponAngleDot)
 		{
-			if (CurrentState != ERangedWeaponState::Idle)
+			// batched notifies arrive after the burst ended and the server went idle, the accepted shot index
+			// and its seed already prove the shot was fired
+			if (!Impact.GetActor())
+			{
+				if (Impact.bBlockingHit)
+				{
+					ConfirmHit();
+				}
+			}
+			// assume it told the truth about static things because the don't move and the hit 
+			// usually doesn't have significant gameplay implications
+			else if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
+			{
+				ConfirmHit();
+			}
+			// rewind pawns to where the client saw them and retest the shot against the stored hitbox
+			else if (const AMortalCryCharacter* HitPawn = Cast<AMortalCryCharacter>(Impact.GetActor()))
 			{
-				if (!Impact.GetActor())
+				if (HitPawn->GetHitboxHistory()->VerifyHit(ClientTimestamp, Shot.ViewLocation, ShootDir, InstantConfig.WeaponRange, Impact.Location, InstantConfig.HitboxLeeway))
 				{
-					if (Impact.bBlockingHit)
-					{
-						ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
-					}
+					ConfirmHit();
 				}
-				// assume it told the truth about static things because the don't move and the hit 
-				// usually doesn't have significant gameplay implications
-				else if (Impact.GetActor()->IsRootComponentStatic() || Impact.GetActor()->IsRootComponentStationary())
+				else
 				{
-					ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
+					RejectHit();
+					//UE_LOG(LogShooterWeapon, Log, TEXT("%s Rejected client side hit of %s (outside rewound hitbox)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
+				}
+			}
+			else
+			{
+				// Get the component bounding box
+				const FBox HitBox = Impact.GetActor()->GetComponentsBoundingBox();
+
+				// calculate the box extent, and increase by a leeway
+				FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
+				BoxExtent *= InstantConfig.ClientSideHitLeeway;
+
+				// avoid precision errors with really thin objects
+				BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
+				BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
+				BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
+
+				// Get the box center
+				const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
+
+				// if we are within client tolerance
+				if (FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
+					FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
+					FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
+				{
+					ConfirmHit();
 				}
 				else
 				{
-					// Get the component bounding box
-					const FBox HitBox = Impact.GetActor()->GetComponentsBoundingBox();
-
-					// calculate the box extent, and increase by a leeway
-					FVector BoxExtent = 0.5 * (HitBox.Max - HitBox.Min);
-					BoxExtent *= InstantConfig.ClientSideHitLeeway;
-
-					// avoid precision errors with really thin objects
-					BoxExtent.X = FMath::Max(20.0f, BoxExtent.X);
-					BoxExtent.Y = FMath::Max(20.0f, BoxExtent.Y);
-					BoxExtent.Z = FMath::Max(20.0f, BoxExtent.Z);
-
-					// Get the box center
-					const FVector BoxCenter = (HitBox.Min + HitBox.Max) * 0.5;
-
-					// if we are within client tolerance
-					if (FMath::Abs(Impact.Location.Z - BoxCenter.Z) < BoxExtent.Z &&
-						FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
-						FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
-					{
-						ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
-					}
-					else
-					{
-						//UE_LOG(LogShooterWeapon, Log, TEXT("%s Rejected client side hit of %s (outside bounding box tolerance)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
-					}
+					RejectHit();
+					//UE_LOG(LogShooterWeapon, Log, TEXT("%s Rejected client side hit of %s (outside bounding box tolerance)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
 				}
 			}
 		}
 		else if (ViewDotHitDir <= InstantConfig.AllowedViewDotHitDir)
 		{
+			RejectHit();
 			//UE_LOG(LogShooterWeapon, Log, TEXT("%s Rejected client side hit of %s (facing too far from the hit direction)"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
 		}
 		else
 		{
+			RejectHit();
 			//UE_LOG(LogShooterWeapon, Log, TEXT("%s Rejected client side hit of %s"), *GetNameSafe(this), *GetNameSafe(Impact.GetActor()));
 		}
 	}
+	else
+	{
+		RejectHit();
+	}
 }
 
-bool ARangedWeapon_Instant::ServerNotifyMiss_Validate(FVector_NetQuantizeNormal ShootDir, int32 RandomSeed,
-	float ReticleSpread)
-{
-	return true;
-}
-
-void ARangedWeapon_Instant::ServerNotifyMiss_Implementation(FVector_NetQuantizeNormal ShootDir, int32 RandomSeed,
-	float ReticleSpread)
+void ARangedWeapon_Instant::ProcessClientMiss(const FVector& ShootDir, int32 RandomSeed, float ReticleSpread)
 {
 	const FVector Origin = GetMuzzleLocation();
 
 	// play FX on remote clients
-	HitNotify.Origin = Origin;
-	HitNotify.RandomSeed = RandomSeed;
-	HitNotify.ReticleSpread = ReticleSpread;
+	ShotHistory.Add(RandomSeed, ReticleSpread);
 
 	// play FX locally
 	if (GetNetMode() != NM_DedicatedServer)
@@ -158,9 +420,7 @@ void ARangedWeapon_Instant::ProcessInstantHit_Confirmed(const FHitResult& Impact
 	// play FX on remote clients
 	if (GetLocalRole() == ROLE_Authority)
 	{
-		HitNotify.Origin = Origin;
-		HitNotify.RandomSeed = RandomSeed;
-		HitNotify.ReticleSpread = ReticleSpread;
+		ShotHistory.Add(RandomSeed, ReticleSpread);
 	}
 
 	// play FX locally
@@ -202,33 +462,20 @@ void ARangedWeapon_Instant::DealDamage(const FHitResult& Impact, const FVector&
 }
 
 void ARangedWeapon_Instant::ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir,
-											int32 RandomSeed, float ReticleSpread)
+											int32 ShotIndex, float ReticleSpread)
 {
 	if (GetMyPawn() && GetMyPawn()->IsLocallyControlled() && GetNetMode() == NM_Client)
 	{
-		// if we're a client and we've hit something that is being controlled by the server
-		if (Impact.GetActor() && Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
+		// if we're a client and we've hit something that is being controlled by the server,
+		// or hit world geometry, or missed, queue it for the next hit notify
+		if (!Impact.GetActor() || Impact.GetActor()->GetRemoteRole() == ROLE_Authority)
 		{
-			// notify the server of the hit
-			ServerNotifyHit(Impact, ShootDir, RandomSeed, ReticleSpread);
-		}
-		else if (!Impact.GetActor())
-		{
-			if (Impact.bBlockingHit)
-			{
-				// notify the server of the hit
-				ServerNotifyHit(Impact, ShootDir, RandomSeed, ReticleSpread);
-			}
-			else
-			{
-				// notify server of the miss
-				ServerNotifyMiss(ShootDir, RandomSeed, ReticleSpread);
-			}
+			QueueHitNotify(Impact, ShotIndex);
 		}
 	}
 
 	// process a confirmed hit
-	ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
+	ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, GetShotSeed(ShotIndex), ReticleSpread);
 }
 
 float ARangedWeapon_Instant::GetCurrentSpread() const
@@ -243,15 +490,17 @@ float ARangedWeapon_Instant::GetCurrentSpread() const
 
 void ARangedWeapon_Instant::SimulateInstantHit(const FVector& ShotOrigin, int32 RandomSeed, float ReticleSpread)
 {
-	FRandomStream WeaponRandomStream(RandomSeed);
-	const float ConeHalfAngle = FMath::DegreesToRadians(ReticleSpread * 0.5f);
-
 	const FVector StartTrace = ShotOrigin;
 	const FVector AimDir = GetAdjustedAim();
-	const FVector ShootDir = WeaponRandomStream.VRandCone(AimDir, ConeHalfAngle, ConeHalfAngle);
+	const FVector ShootDir = GetShotDirection(AimDir, RandomSeed, ReticleSpread);
 	const FVector EndTrace = StartTrace + ShootDir * InstantConfig.WeaponRange;
 
-	FHitResult Impact = WeaponTrace(StartTrace, EndTrace);
+	RequestWeaponTrace(StartTrace, EndTrace,
+		FWeaponTraceDelegate::CreateUObject(this, &ARangedWeapon_Instant::OnSimulatedTraced, EndTrace));
+}
+
+void ARangedWeapon_Instant::OnSimulatedTraced(const FHitResult& Impact, FVector EndTrace)
+{
 	if (Impact.bBlockingHit)
 	{
 		SpawnImpactEffects(Impact);
@@ -263,15 +512,34 @@ void ARangedWeapon_Instant::SimulateInstantHit(const FVector& ShotOrigin, int32
 	}
 }
 
-void ARangedWeapon_Instant::OnRep_HitNotify()
+void ARangedWeapon_Instant::OnRep_ShotHistory()
 {
-	SimulateInstantHit(HitNotify.Origin, HitNotify.RandomSeed, HitNotify.ReticleSpread);
+	// shots fired before this weapon became relevant are not worth replaying
+	if (!HasActorBegunPlay())
+	{
+		LastSimulatedShot = ShotHistory.Sequence;
+		return;
+	}
+
+	const uint8 NumNewShots = static_cast<uint8>(ShotHistory.Sequence - LastSimulatedShot);
+	const int32 NumShotsToReplay = FMath::Min<int32>(NumNewShots, FInstantShotHistory::Size);
+
+	const FVector Origin = GetMuzzleLocation();
+	for (int32 Index = NumShotsToReplay; Index > 0; --Index)
+	{
+		const FInstantShotInfo& Shot = ShotHistory.Get(static_cast<uint8>(ShotHistory.Sequence - Index));
+		SimulateInstantHit(Origin, Shot.RandomSeed, Shot.GetSpread());
+	}
+
+	LastSimulatedShot = ShotHistory.Sequence;
 }
 
 void ARangedWeapon_Instant::OnBurstFinished()
 {
 	Super::OnBurstFinished();
 
+	FlushHitNotifies();
+
 	CurrentFiringSpread = 0.f;
 }
 
@@ -279,6 +547,11 @@ void ARangedWeapon_Instant::SpawnImpactEffects(const FHitResult& Impact)
 {
 	if (ImpactTemplate && Impact.bBlockingHit)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_WeaponImpactEffects);
+		CSV_SCOPED_TIMING_STAT(MortalCryWeapons, ImpactEffects);
+
+		INC_DWORD_STAT(STAT_WeaponImpactsPlayed);
+
 		FHitResult UseImpact = Impact;
 
 		// trace again to find component lost during replication
@@ -287,36 +560,57 @@ void ARangedWeapon_Instant::SpawnImpactEffects(const FHitResult& Impact)
 			const FVector StartTrace = Impact.ImpactPoint + Impact.ImpactNormal * 10.0f;
 			const FVector EndTrace = Impact.ImpactPoint - Impact.ImpactNormal * 10.0f;
 			FHitResult Hit = WeaponTrace(StartTrace, EndTrace);
-			UseImpact = Hit;
+			if (Hit.bBlockingHit)
+			{
+				UseImpact = Hit;
+			}
 		}
 
-		FTransform const SpawnTransform(Impact.ImpactNormal.Rotation(), Impact.ImpactPoint);
-		AImpactEffect* EffectActor = GetWorld()->SpawnActorDeferred<AImpactEffect>(ImpactTemplate, SpawnTransform);
-		if (EffectActor)
+		if (UImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UImpactEffectSubsystem>())
 		{
-			EffectActor->SurfaceHit = UseImpact;
-			UGameplayStatics::FinishSpawningActor(EffectActor, SpawnTransform);
+			ImpactEffects->PlayImpact(ImpactTemplate, UseImpact);
 		}
 	}
 }
 
 void ARangedWeapon_Instant::SpawnTrailEffect(const FVector& EndPoint)
 {
-	if (TrailFX)
+	if (TrailFX && GetNetMode() != NM_DedicatedServer)
 	{
 		const FVector Origin = GetMuzzleLocation();
-
-		UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, TrailFX, Origin);
-		if (TrailPSC)
+		if (ShouldCullTrail(Origin, EndPoint))
 		{
-			TrailPSC->SetVectorParameter(TrailTargetParam, EndPoint);
+			return;
 		}
+
+		UParticleSystemComponent* TrailPSC = AcquirePooledEffect(TrailFX);
+		TrailPSC->SetWorldLocationAndRotation(Origin, FRotator::ZeroRotator);
+		TrailPSC->SetVectorParameter(TrailTargetParam, EndPoint);
+		TrailPSC->ActivateSystem(true);
 	}
 }
 
+bool ARangedWeapon_Instant::ShouldCullTrail(const FVector& Origin, const FVector& EndPoint) const
+{
+	if (!GetMyPawn() || GetMyPawn()->IsLocallyControlled())
+	{
+		return false;
+	}
+
+	APlayerController* LocalPC = GetWorld()->GetFirstPlayerController();
+	if (!LocalPC || !LocalPC->PlayerCameraManager)
+	{
+		return false;
+	}
+
+	const FVector ViewLocation = LocalPC->PlayerCameraManager->GetCameraLocation();
+	return FMath::PointDistToSegmentSquared(ViewLocation, Origin, EndPoint) > FMath::Square(TrailCullDistance);
+}
+
 void ARangedWeapon_Instant::GetLifetimeReplicatedProps( TArray< FLifetimeProperty > & OutLifetimeProps ) const
 {
 	Super::GetLifetimeReplicatedProps( OutLifetimeProps );
 
-	DOREPLIFETIME_CONDITION( ARangedWeapon_Instant, HitNotify, COND_SkipOwner );
+	DOREPLIFETIME_CONDITION( ARangedWeapon_Instant, ShotHistory, COND_SkipOwner );
+	DOREPLIFETIME_CONDITION( ARangedWeapon_Instant, ShotSeedBase, COND_InitialOnly );
 }
\ No newline at end of file
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/Ranged/WeaponTraceSubsystem.h"
+
+#include "MortalCry.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+
+UWeaponTraceSubsystem::UWeaponTraceSubsystem()
+{
+	bFlushing = false;
+	NumTracesFlushed = 0;
+}
+
+void UWeaponTraceSubsystem::RequestTrace(const FVector& Start, const FVector& End, ECollisionChannel TraceChannel,
+										const FCollisionQueryParams& Params, FWeaponTraceDelegate&& OnTraced)
+{
+	FWeaponTraceRequest& Request = PendingRequests.AddDefaulted_GetRef();
+	Request.Start = Start;
+	Request.End = End;
+	Request.TraceChannel = TraceChannel;
+	Request.Params = Params;
+	Request.OnTraced = MoveTemp(OnTraced);
+}
+
+void UWeaponTraceSubsystem::Flush()
+{
+	// callbacks may queue new traces, those are picked up by the next pass
+	if ( bFlushing )
+	{
+		return;
+	}
+
+	TGuardValue<bool> FlushGuard(bFlushing, true);
+
+	UWorld* World = GetWorld();
+
+	while ( PendingRequests.Num() > 0 )
+	{
+		Swap(InFlightRequests, PendingRequests);
+
+		const int32 NumRequests = InFlightRequests.Num();
+		Results.Reset(NumRequests);
+		Results.SetNum(NumRequests);
+
+		NumTracesFlushed += NumRequests;
+
+		INC_DWORD_STAT_BY(STAT_WeaponTraces, NumRequests);
+		CSV_CUSTOM_STAT(MortalCryWeapons, Traces, NumRequests, ECsvCustomStatOp::Accumulate);
+
+		// scene queries only read the physics scene, so every request can be traced independently
+		{
+			SCOPE_CYCLE_COUNTER(STAT_WeaponTrace);
+			CSV_SCOPED_TIMING_STAT(MortalCryWeapons, Trace);
+
+			ParallelFor(NumRequests, [this, World](int32 Index)
+			{
+				const FWeaponTraceRequest& Request = InFlightRequests[Index];
+				World->LineTraceSingleByChannel(Results[Index], Request.Start, Request.End, Request.TraceChannel, Request.Params);
+			}, NumRequests < MinParallelBatchSize);
+		}
+
+		// hand results back in submission order to keep hit processing deterministic
+		for (int32 Index = 0; Index < NumRequests; ++Index)
+		{
+			InFlightRequests[Index].OnTraced.ExecuteIfBound(Results[Index]);
+		}
+
+		InFlightRequests.Reset();
+	}
+}
+
+void UWeaponTraceSubsystem::Tick(float DeltaTime)
+{
+	Flush();
+}
+
+bool UWeaponTraceSubsystem::IsTickable() const
+{
+	return PendingRequests.Num() > 0;
+}
+
+ETickableTickType UWeaponTraceSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UWeaponTraceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UWeaponTraceSubsystem, STATGROUP_Tickables);
+}
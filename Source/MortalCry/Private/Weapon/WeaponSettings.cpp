@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Weapon/WeaponSettings.h"
+
+#include "Weapon/Ranged/MortalCryProjectile.h"
+
+UWeaponSettings::UWeaponSettings(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer)
+{
+	ImpactEffectPoolSize = 32;
+	DefaultImpactDecalLifeSpan = 10.f;
+	DefaultProjectilePoolSize = 16;
+	MaxSimulatedProjectiles = 8192;
+}
+
+const UWeaponSettings* UWeaponSettings::Get()
+{
+	return GetDefault<UWeaponSettings>();
+}
+
+int32 UWeaponSettings::GetProjectilePoolSize(TSubclassOf<AMortalCryProjectile> ProjectileClass) const
+{
+	// subclasses share the size of the closest configured parent
+	for (UClass* Class = ProjectileClass; Class; Class = Class->GetSuperClass())
+	{
+		if (const int32* PoolSize = ProjectilePoolSizes.Find(TSoftClassPtr<AMortalCryProjectile>(Class)))
+		{
+			return FMath::Max(*PoolSize, 0);
+		}
+	}
+
+	return DefaultProjectilePoolSize;
+}
@@ -6,30 +6,82 @@
 #include "Components/ActorComponent.h"
 #include "HealthComponent.generated.h"
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FHealthChangedSignature, float, Health, float, HealthChange);
+
+/** damage one instigator dealt since the last flush */
+struct FPendingDamage
+{
+	TWeakObjectPtr<AController> Instigator;
+	float Damage;
+
+	/** where the strongest hit came from and landed, reported to AI perception */
+	FVector Origin;
+	FVector Location;
+	float StrongestHit;
+};
 
 UCLASS( ClassGroup=(Custom), BlueprintType, meta=(BlueprintSpawnableComponent) )
 class MORTALCRY_API UHealthComponent : public UActorComponent
 {
 	GENERATED_BODY()
-    
+
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Health, meta = (AllowPrivateAccess="True"))
     float MaxHealth;
 
+    /** authoritative on the server, rebuilt from the quantized values on clients */
     UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=Health, meta = (AllowPrivateAccess="True"))
     float Health;
-    
-public:	
+
+    /** health fraction in 1/65535 steps, for the owning client's HUD */
+    UPROPERTY(ReplicatedUsing=OnRep_OwnerHealth)
+    uint16 OwnerHealth;
+
+    /** health fraction in 1/255 steps, enough for other players' health bars and only sent when a step changes */
+    UPROPERTY(ReplicatedUsing=OnRep_ProxyHealth)
+    uint8 ProxyHealth;
+
+    /** one entry per instigator, reported once per tick */
+    TArray<FPendingDamage, TInlineAllocator<4>> PendingDamage;
+
+    /** health already taken by queued damage and not yet broadcast */
+    float PendingHealthChange;
+
+    UFUNCTION()
+    void OnRep_OwnerHealth();
+
+    UFUNCTION()
+    void OnRep_ProxyHealth();
+
+    void SetHealth(float NewHealth);
+    /** set and quantize the health without telling anyone, returns the change */
+    float ApplyHealth(float NewHealth);
+    void FlushPendingDamage();
+
+public:
     // Sets default values for this component's properties
     explicit UHealthComponent(const FObjectInitializer& ObjectInitializer);
 
+    virtual void BeginPlay() override;
+    virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+    virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+    virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+    /** called on the server and on clients once per applied change, with the new health fraction */
+    UPROPERTY(BlueprintAssignable, Category=Health)
+    FHealthChangedSignature OnHealthChanged;
+
     UFUNCTION(BlueprintCallable, Category=Health)
     void Update(float HealthChange);
 
+    /** take damage at once, the notifications of a frame are merged into one health change and one perception report per instigator */
+    void QueueDamage(float Damage, AController* EventInstigator, const FVector& Origin, const FVector& Location);
+
+    /** fraction of max health, queued damage already counts */
     UFUNCTION(BlueprintPure, Category=Health)
     float GetHealth() const;
 
     UFUNCTION(BlueprintPure, Category=Health)
     bool IsAlive() const;
 
-		
+
 };
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "HitboxHistoryComponent.generated.h"
+
+/**
+ * Fixed-size ring of past hitbox poses.
+ * Kept as a structure of arrays so a rewind only walks the timestamps until it finds its samples.
+ */
+struct MORTALCRY_API FHitboxHistory
+{
+	/** enough samples for the longest rewind at 120 ticks a second */
+	static constexpr int32 Capacity = 64;
+
+	float Times[Capacity];
+	FVector Centers[Capacity];
+	FVector Extents[Capacity];
+
+	/** slot written by the next sample */
+	int32 Head;
+
+	/** number of valid samples */
+	int32 Num;
+
+	FHitboxHistory() : Head(0), Num(0) {}
+
+	void Reset();
+	void Record(float Time, const FVector& Center, const FVector& Extent);
+
+	/** box interpolated at the given time, clamped to the oldest and newest samples */
+	bool GetBoxAt(float Time, FBox& OutBox) const;
+};
+
+/**
+ * Records the owning pawn's hitbox on the server so client hits can be verified against
+ * where the pawn was when the shooter fired.
+ */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class MORTALCRY_API UHitboxHistoryComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+	/** how far back the server is allowed to rewind */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category=HitVerification, meta = (AllowPrivateAccess="True", ClampMin="0"))
+	float MaxRewindTime;
+
+	FHitboxHistory History;
+
+public:
+	explicit UHitboxHistoryComponent(const FObjectInitializer& ObjectInitializer);
+
+protected:
+	virtual void BeginPlay() override;
+
+public:
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** time base shared by the server history and client hit timestamps */
+	static float GetTimestamp(const UWorld* World);
+
+	/** hitbox of the owner at the given server time */
+	bool GetHitboxAt(float Timestamp, FBox& OutBox) const;
+
+	/** does a shot from ShotStart along ShotDir landing on ImpactLocation agree with the owner's rewound hitbox */
+	bool VerifyHit(float Timestamp, const FVector& ShotStart, const FVector& ShotDir, float ShotRange, const FVector& ImpactLocation, float Leeway) const;
+};
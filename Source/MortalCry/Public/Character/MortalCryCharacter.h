@@ -4,8 +4,10 @@
 
 #include "CoreMinimal.h"
 
+#include "CollisionQueryParams.h"
 #include "GenericTeamAgentInterface.h"
 #include "HealthComponent.h"
+#include "HitboxHistoryComponent.h"
 #include "Engine/DataTable.h"
 #include "GameFramework/Character.h"
 #include "Inventory/InventoryComponent.h"
@@ -89,10 +91,24 @@ private:
 	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category=Mesh, meta = (AllowPrivateAccess = "true"))
 	UHealthComponent* Health;
 
+	/** per damage event type, called by TakeDamage with the damage that got through */
+	void HandlePointDamage(float ActualDamage, const FPointDamageEvent& DamageEvent, AController* EventInstigator);
+	void HandleRadialDamage(float ActualDamage, const FRadialDamageEvent& DamageEvent, AController* EventInstigator);
+	void HandleGenericDamage(float ActualDamage, AController* EventInstigator, AActor* DamageCauser);
+
 public:
 	UFUNCTION(BlueprintPure, Category = Health)
 	virtual bool IsAlive() const { return Health->GetHealth() > 0.f; }
 
+	////////////////////
+	// Hit verification
+private:
+	UPROPERTY(VisibleDefaultsOnly, BlueprintReadOnly, Category=HitVerification, meta = (AllowPrivateAccess = "true"))
+	UHitboxHistoryComponent* HitboxHistory;
+
+public:
+	FORCEINLINE UHitboxHistoryComponent* GetHitboxHistory() const { return HitboxHistory; }
+
 	/////////////
 	// Inventory
 private:
@@ -126,7 +142,41 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Interaction, meta = (AllowPrivateAccess = "true"))
 	float InteractLength;
 
+	/** seconds an interaction trace is reused for while the view holds still, 0 traces on every query */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Interaction, meta = (AllowPrivateAccess = "true"))
+	float InteractTraceInterval;
+
+	/** view movement that retraces before the interval is up */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Interaction, meta = (AllowPrivateAccess = "true"))
+	float InteractTraceMoveThreshold;
+
+	/** view rotation in degrees that retraces before the interval is up */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Interaction, meta = (AllowPrivateAccess = "true"))
+	float InteractTraceAngleThreshold;
+
+	/** whatever the last interaction trace hit, filtered by interface on every query */
+	TWeakObjectPtr<AActor> CachedInteractHit;
+	FVector CachedInteractStart;
+	FVector CachedInteractDirection;
+	float LastInteractTraceTime;
+	uint64 LastInteractTraceFrame;
+
+	/** kept between traces so the ignore list is refilled instead of reallocated */
+	TArray<AActor*> InteractIgnoredActors;
+	FCollisionQueryParams InteractTraceParams;
+
+	/** the actor in front of the view, retraced only when the cached one is too old or the view moved */
+	AActor* GetInteractTraceHit();
+
+	/** informative actor in view of the local player, the last one broadcast to OnInteractFocusChanged */
+	TWeakObjectPtr<AActor> InteractFocus;
+
+	void UpdateInteractFocus();
+
 public:
+	/** make the next interaction query trace again */
+	FORCEINLINE void InvalidateInteractTrace() { LastInteractTraceFrame = 0; LastInteractTraceTime = -BIG_NUMBER; }
+
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent)
 	AActor* InteractTrace(TSubclassOf<UInterface> SearchClass);
 
@@ -143,6 +193,13 @@ protected:
 	UPROPERTY(BlueprintAssignable)
 	FInteractSiganture OnDrop;
 
+public:
+	/** the informative actor in view of the local player changed, null when there is none anymore */
+	UPROPERTY(BlueprintAssignable)
+	FInteractSiganture OnInteractFocusChanged;
+
+	FORCEINLINE AActor* GetInteractFocus() const { return InteractFocus.Get(); }
+
 private:
 	UFUNCTION()
 	void OnPickUpWeapon(AActor* Item);
@@ -161,8 +218,9 @@ protected:
 	void EndInteract();
 
 private:
+	/** prediction id of the inventory change the client made ahead of a pickup, 0 when there is none */
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerInteract(AActor* InInteractiveActor);
+	void ServerInteract(AActor* InInteractiveActor, int32 PredictionId);
 	
 	UFUNCTION(Server, Reliable)
 	void ServerStopInteract();
@@ -268,6 +326,7 @@ public:
 	virtual void Destroyed() override;
 protected:
 	virtual void BeginPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
 
 	// APawn interface
 	virtual void SetupPlayerInputComponent(UInputComponent* InputComponent) override;
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** gameplay interfaces tracked by FGameplayInterfaceCache, one bit each */
+enum class EGameplayInterface : uint8
+{
+	Interactive,
+	Collectable,
+	Usable,
+	Informative,
+	Possessive,
+	Weapon,
+	RangedWeapon,
+
+	Num
+};
+
+/**
+ * Per class bitmask of the gameplay interfaces it implements, so hot paths test a bit instead of walking the class interface list.
+ * Built lazily on the game thread and cleared after garbage collection and plugin mounts, which may unload or replace classes,
+ * after code reloads, and in the editor after Blueprint compiles, which keep the same class object while changing its interfaces.
+ */
+class MORTALCRY_API FGameplayInterfaceCache
+{
+public:
+	static void Startup();
+	static void Shutdown();
+
+	/** bits of every tracked interface the class implements */
+	static uint32 GetMask(const UClass* Class);
+
+	/** bit of a tracked interface class, 0 when it is not tracked */
+	static uint32 GetInterfaceMask(const UClass* InterfaceClass);
+
+	FORCEINLINE static uint32 GetInterfaceMask(EGameplayInterface Interface) { return 1u << static_cast<uint8>(Interface); }
+
+	FORCEINLINE static bool Implements(const UClass* Class, EGameplayInterface Interface)
+	{
+		return (GetMask(Class) & GetInterfaceMask(Interface)) != 0;
+	}
+
+	/** for any interface class, untracked ones fall back to the class interface list */
+	static bool Implements(const UClass* Class, const UClass* InterfaceClass);
+
+	template<typename InterfaceType>
+	FORCEINLINE static bool Implements(const UObject* Object)
+	{
+		return Object && Implements(Object->GetClass(), InterfaceType::StaticClass());
+	}
+
+	static void Invalidate();
+
+	/** changes on every invalidation, anyone keeping masks compares it to know theirs may be stale */
+	FORCEINLINE static uint32 GetVersion() { return Version; }
+
+private:
+	/** indexed by the object index of the class, which is only reused after a garbage collection clears the cache anyway */
+	static TArray<uint32> Masks;
+
+	/** set on masks that were built, so a class implementing nothing is not looked up again */
+	static constexpr uint32 KnownMaskBit = 1u << 31;
+
+	static uint32 Version;
+	static const UClass* InterfaceClasses[static_cast<uint8>(EGameplayInterface::Num)];
+
+	static FDelegateHandle PostGarbageCollectHandle;
+	static FDelegateHandle NewPluginMountedHandle;
+	static FDelegateHandle ReloadCompleteHandle;
+
+#if WITH_EDITOR
+	/** GEditor does not exist yet when game modules start up */
+	static void BindEditorDelegates();
+
+	static FDelegateHandle PostEngineInitHandle;
+	static FDelegateHandle BlueprintCompiledHandle;
+#endif
+};
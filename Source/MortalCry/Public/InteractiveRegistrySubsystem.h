@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+
+#include "InteractiveRegistrySubsystem.generated.h"
+
+struct FInteractiveEntry
+{
+	/** also the lookup key, which stays valid after the actor is gone */
+	TObjectKey<AActor> Actor;
+	FVector Location;
+	FIntPoint Cell;
+
+	/** indexed interfaces the actor implements, bits of the gameplay interface cache */
+	uint32 InterfaceMask;
+};
+
+/**
+ * Grid index of every actor implementing Interactive, Collectable or Usable in a world, kept up to date on spawn, move and end play.
+ * Answers radius and nearest queries without physics, for the HUD and for bots looking for items.
+ * Items held by someone, attached or hidden, are set aside until they are dropped, as nobody can pick them up.
+ */
+UCLASS()
+class MORTALCRY_API UInteractiveRegistrySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	TArray<FInteractiveEntry> Entries;
+	TMap<TObjectKey<AActor>, int32> EntryIndices;
+
+	/** entry indices per horizontal cell, height is left out as levels are much wider than tall */
+	TMap<FIntPoint, TArray<int32>> Cells;
+
+	/** held items, not indexed and not followed, checked again before each query */
+	TSet<TObjectKey<AActor>> DormantActors;
+
+	bool bNeedsLevelScan;
+
+	/** version of the gameplay interface cache the entry masks were read from */
+	uint32 InterfaceMaskVersion;
+
+	FDelegateHandle ActorSpawnedHandle;
+	FDelegateHandle LevelAddedHandle;
+
+	void RegisterActor(AActor* Actor);
+	void UnregisterActor(AActor* Actor);
+	void RemoveEntry(int32 EntryIndex);
+
+	/** take an actor out of the grid until it is dropped */
+	void MakeDormant(AActor* Actor);
+	/** index the dormant actors that were dropped since the last query */
+	void WakeDormantActors();
+
+	/** attached to someone or hidden, like a held weapon or a cached equip actor */
+	static bool IsHeld(const AActor* Actor);
+
+	void RegisterLevel(ULevel* Level);
+	void ScanLevelsIfNeeded();
+
+	/** read the entry masks again after the interface cache was invalidated, a Blueprint compile may have changed them */
+	void RefreshInterfaceMasksIfNeeded();
+
+	void HandleLevelAdded(ULevel* Level, UWorld* World);
+	void HandleTransformUpdated(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	UFUNCTION()
+	void HandleActorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+	FIntPoint GetCell(const FVector& Location) const;
+	/** interface bits of the gameplay interface cache the registry indexes */
+	static uint32 GetIndexedMask();
+
+	/** call a function on the entries of every cell within a square ring around a cell */
+	template<typename FunctionType>
+	void ForEachEntryInRing(const FIntPoint& CenterCell, int32 Ring, FunctionType&& Function) const;
+
+public:
+	UInteractiveRegistrySubsystem();
+
+	/** side of a grid cell, queries read every cell their radius touches */
+	static constexpr float CellSize = 1000.f;
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** actors implementing an interface within a radius, in no particular order */
+	UFUNCTION(BlueprintCallable, Category = Interaction)
+	void FindInRadius(const FVector& Center, float Radius, TSubclassOf<UInterface> SearchClass, TArray<AActor*>& OutActors);
+
+	/** up to MaxResults actors implementing an interface within a radius, nearest first */
+	UFUNCTION(BlueprintCallable, Category = Interaction)
+	void FindNearest(const FVector& Center, float Radius, TSubclassOf<UInterface> SearchClass, int32 MaxResults, TArray<AActor*>& OutActors);
+
+	FORCEINLINE int32 GetNumRegistered() const { return Entries.Num(); }
+};
@@ -5,42 +5,102 @@
 #include "CoreMinimal.h"
 
 #include "Components/ActorComponent.h"
+#include "Inventory/ItemInfoSubsystem.h"
+#include "Net/Serialization/FastArraySerializer.h"
 
 #include "InventoryComponent.generated.h"
 
+class UInventoryComponent;
+struct FInventoryList;
+
+/** how much of a collectable class the inventory holds, only the class and amount go on the wire */
 USTRUCT(BlueprintType)
-struct FCollectedItem
+struct FInventorySlot : public FFastArraySerializerItem
 {
 	GENERATED_BODY()
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
-	TSubclassOf<AActor> Item;
+	TSubclassOf<AActor> ItemClass;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
-	UTexture2D* Icon;
+	int32 Amount;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
-	FString Name;
+	/** amount last seen by this machine, to apply replicated changes as deltas */
+	UPROPERTY(NotReplicated)
+	int32 PreviousAmount;
 
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
-	FString Description;
-	
-	friend bool operator==(const FCollectedItem& Lhs, const FCollectedItem& RHS)
+	FInventorySlot()
+		: Amount(0)
+		, PreviousAmount(0)
 	{
-		return Lhs.Item == RHS.Item;
 	}
 
-	friend bool operator!=(const FCollectedItem& Lhs, const FCollectedItem& RHS) { return !(Lhs == RHS); }
+	void PreReplicatedRemove(const FInventoryList& InArraySerializer);
+	void PostReplicatedAdd(const FInventoryList& InArraySerializer);
+	void PostReplicatedChange(const FInventoryList& InArraySerializer);
+};
+
+/** slots delta replicated per item, a pickup or ammo use only sends the slot that changed */
+USTRUCT(BlueprintType)
+struct FInventoryList : public FFastArraySerializer
+{
+	GENERATED_BODY()
 
-	friend uint32 GetTypeHash(const FCollectedItem& CollectedItem)
+	UPROPERTY(BlueprintReadOnly, Category = Inventory)
+	TArray<FInventorySlot> Slots;
+
+	/** component the list belongs to, set in its PostInitProperties */
+	UInventoryComponent* Owner;
+
+	FInventoryList()
+		: Owner(nullptr)
+	{
+	}
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
 	{
-		return GetTypeHash(CollectedItem.Item)
-			+ GetTypeHash(CollectedItem.Icon)
-			+ GetTypeHash(CollectedItem.Name)
-			+ GetTypeHash(CollectedItem.Description);
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventorySlot, FInventoryList>(Slots, DeltaParms, *this);
 	}
 };
 
+template<>
+struct TStructOpsTypeTraits<FInventoryList> : public TStructOpsTypeTraitsBase2<FInventoryList>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/** a change the owning client applied ahead of the server, kept until the server acks its id */
+USTRUCT()
+struct FPredictedInventoryChange
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int32 PredictionId;
+
+	UPROPERTY()
+	TSubclassOf<AActor> ItemClass;
+
+	UPROPERTY()
+	int32 Amount;
+
+	/** applied by the server some time after it got the request, acked in its own sequence */
+	UPROPERTY()
+	bool bDeferred;
+
+	FPredictedInventoryChange()
+		: PredictionId(0)
+		, Amount(0)
+		, bDeferred(false)
+	{
+	}
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FInventorySlotSignature, TSubclassOf<AActor>, ItemClass, int32, Amount);
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class MORTALCRY_API UInventoryComponent : public UActorComponent
 {
@@ -57,39 +117,135 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Inventory, meta = (AllowPrivateAccess = "True"))
 	int32 MaxItems;
 	
+	/** one slot per collected class, in pickup order on the server, clients may see another order */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Replicated, Category = Inventory, meta = (AllowPrivateAccess = "True"))
-	TMap<FCollectedItem, int32> Items;
+	FInventoryList Slots;
+
+	/** sum of the slot amounts, kept in step with every change */
+	int32 UsedSpace;
+
+	/** owning client changes the server has not acked yet, oldest first, layered over the replicated slots */
+	UPROPERTY(Transient)
+	TArray<FPredictedInventoryChange> PendingChanges;
+
+	/** last prediction id handed out by the owning client */
+	int32 LastPredictionId;
+
+	/** newest prediction the server has processed, applied or refused, replicated with the slots it produced */
+	UPROPERTY(ReplicatedUsing = OnRep_LastAckedPredictionId)
+	int32 LastAckedPredictionId;
+
+	/** same for deferred predictions, a later immediate ack must not drop one the server has yet to apply */
+	UPROPERTY(ReplicatedUsing = OnRep_LastAckedPredictionId)
+	int32 LastAckedDeferredPredictionId;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Replicated, Category = Inventory, meta = (AllowPrivateAccess = "True"))
 	AActor* EquippedItem;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Inventory, meta = (AllowPrivateAccess = "True"))
 	FName AttachSocketName; 
+
+	/** item actors spawned on first equip, hidden while another slot is equipped, server only */
+	UPROPERTY(Transient)
+	TMap<UClass*, AActor*> EquipCache;
 	
 protected:
+	virtual void PostInitProperties() override;
+
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** drop the acked changes, whatever the server refused rolls back with them */
+	UFUNCTION()
+	void OnRep_LastAckedPredictionId();
 	
 public:
+	/** a class was collected for the first time */
+	UPROPERTY(BlueprintAssignable, Category = Inventory)
+	FInventorySlotSignature OnSlotAdded;
+
+	/** the amount of a collected class changed */
+	UPROPERTY(BlueprintAssignable, Category = Inventory)
+	FInventorySlotSignature OnSlotChanged;
+
+	/** the last of a class was used up */
+	UPROPERTY(BlueprintAssignable, Category = Inventory)
+	FInventorySlotSignature OnSlotRemoved;
+
+	/** apply a slot change from replication or the server */
+	void HandleSlotAdded(FInventorySlot& Slot);
+	void HandleSlotChanged(FInventorySlot& Slot);
+	void HandleSlotRemoved(FInventorySlot& Slot);
+
 	UFUNCTION(BlueprintCallable)
 	void Collect(AActor* Item);
 
+	/** collect an item locally on the owning client, returns the id to send the server or 0 when nothing was predicted */
+	int32 PredictCollect(AActor* Item);
+
+	/** apply a change locally on the owning client, returns its id or 0 when this machine does not predict,
+	 * deferred changes are the ones the server applies later than it receives them, like a reload */
+	int32 PredictChange(TSubclassOf<AActor> ItemClass, int32 Amount, bool bDeferred = false);
+
+	/** mark every prediction up to an id as processed on the server */
+	void AckPrediction(int32 PredictionId);
+
+	/** mark every deferred prediction up to an id as processed on the server */
+	void AckDeferredPrediction(int32 PredictionId);
+
+	/** amount of a prediction that is still pending, 0 once it was acked */
+	int32 GetPendingAmount(int32 PredictionId) const;
+
 	UFUNCTION(BlueprintCallable)
-	bool Contains(TSubclassOf<AActor> ItemClass);
+	bool Contains(TSubclassOf<AActor> ItemClass) const;
+
+	UFUNCTION(BlueprintCallable)
+	int32 GetAmount(TSubclassOf<AActor> ItemClass) const;
 	
 	UFUNCTION(BlueprintCallable)
 	int32 Use(TSubclassOf<AActor> ItemClass, int32 Amount = 1);
 	
-	UFUNCTION(BlueprintCallable, Server, Reliable)
+	/** equip the item in a slot of this machine's view of the inventory */
+	UFUNCTION(BlueprintCallable)
 	void Equip(int32 Index, bool IsValid);
 
+	/** display data of an item class, from the shared per class cache */
+	UFUNCTION(BlueprintCallable)
+	bool GetItemInfo(TSubclassOf<AActor> ItemClass, FCollectedItem& OutItemInfo) const;
+
+	FORCEINLINE const TArray<FInventorySlot>& GetSlots() const { return Slots.Slots; }
+
 protected:
+	/** used space including the pending predictions */
 	int32 GetUsedSpace() const;
-	
+
+	int32 FindSlot(TSubclassOf<AActor> ItemClass) const;
+
+	/** sum of the pending predictions for a class */
+	int32 GetPredictedAmount(TSubclassOf<AActor> ItemClass) const;
+
+	/** change the authoritative slots, server only */
+	void CollectItem(TSubclassOf<AActor> ItemClass, int32 Amount = 1);
+
+	/** the client already took the amount from its own view, the server applies what it really has */
+	UFUNCTION(Server, Reliable)
+	void ServerUse(TSubclassOf<AActor> ItemClass, int32 Amount, int32 PredictionId);
+
+	/** slot indices differ between machines, so the server is sent the class */
 	UFUNCTION(Server, Reliable)
-	void CollectItem(FCollectedItem Item, int32 Amount = 1);
+	void ServerEquip(TSubclassOf<AActor> ItemClass);
+
+	/** the cached actor of an item class, spawned attached and hidden the first time it is asked for */
+	AActor* GetOrSpawnEquipActor(TSubclassOf<AActor> ItemClass);
+
+	void SetEquipActorActive(AActor* Item, bool bActive) const;
+
+	/** destroy the cached actor of a class once its slot is gone */
+	void ReleaseEquipActor(TSubclassOf<AActor> ItemClass);
 	
 	UFUNCTION()
 	bool CanCollect(AActor* Item) const;
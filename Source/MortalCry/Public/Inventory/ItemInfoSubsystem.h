@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Subsystems/GameInstanceSubsystem.h"
+
+#include "ItemInfoSubsystem.generated.h"
+
+/** display data of a collectable class, kept once per class instead of per inventory entry */
+USTRUCT(BlueprintType)
+struct FCollectedItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
+	TSubclassOf<AActor> Item;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
+	UTexture2D* Icon;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
+	FText Name;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
+	FText Description;
+
+	/** default size of one item of the class */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Item)
+	int32 Size;
+
+	FCollectedItem()
+		: Icon(nullptr)
+		, Size(1)
+	{
+	}
+};
+
+/**
+ * Display data of item classes, read once from the class default object the first time a class is asked for.
+ */
+UCLASS()
+class MORTALCRY_API UItemInfoSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FCollectedItem> ItemInfos;
+
+public:
+	/** display data of a class, null for classes that are neither collectable nor informative */
+	const FCollectedItem* FindItemInfo(TSubclassOf<AActor> ItemClass);
+
+	UFUNCTION(BlueprintCallable, Category = Inventory)
+	bool GetItemInfo(TSubclassOf<AActor> ItemClass, FCollectedItem& OutItemInfo);
+
+	static UItemInfoSubsystem* Get(const UObject* WorldContextObject);
+};
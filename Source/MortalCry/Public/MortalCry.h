@@ -3,3 +3,30 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
+
+/** weapon pipeline, "stat MortalCryWeapons" in game, csv category MortalCryWeapons for headless captures */
+DECLARE_STATS_GROUP(TEXT("MortalCry Weapons"), STATGROUP_MortalCryWeapons, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire"), STAT_WeaponFire, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Trace"), STAT_WeaponTrace, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Hit Verification"), STAT_WeaponHitVerification, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Impact Effects"), STAT_WeaponImpactEffects, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RPC Send"), STAT_WeaponRPCSend, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RPC Receive"), STAT_WeaponRPCReceive, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile Simulation"), STAT_WeaponProjectileSimulation, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Point Damage"), STAT_WeaponPointDamage, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Radial Damage"), STAT_WeaponRadialDamage, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Generic Damage"), STAT_WeaponGenericDamage, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Fired"), STAT_WeaponShotsFired, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces"), STAT_WeaponTraces, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits Verified"), STAT_WeaponHitsVerified, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits Rejected"), STAT_WeaponHitsRejected, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Impacts Played"), STAT_WeaponImpactsPlayed, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits Sent"), STAT_WeaponHitsSent, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits Received"), STAT_WeaponHitsReceived, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Simulated Projectiles"), STAT_WeaponSimulatedProjectiles, STATGROUP_MortalCryWeapons, MORTALCRY_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(MORTALCRY_API, MortalCryWeapons);
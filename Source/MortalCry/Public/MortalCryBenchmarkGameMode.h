@@ -0,0 +1,86 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MortalCryGameMode.h"
+#include "MortalCryBenchmarkGameMode.generated.h"
+
+class AMortalCryCharacter;
+class ARangedWeapon_Instant;
+
+/**
+ * Headless weapon throughput benchmark, spawns armed bots that fire nonstop and reports server cost.
+ * Run a dedicated server with -nullrhi on any map with
+ *   ?game=/Script/MortalCry.MortalCryBenchmarkGameMode?Bots=32?Duration=60?Warmup=5?Weapon=/Game/Path/BP_Weapon.BP_Weapon_C
+ * Results are logged and written to Saved/Profiling/Benchmark, then the server exits.
+ * The BenchmarkDamage console command times TakeDamage per damage event type on a spare character.
+ */
+UCLASS()
+class MORTALCRY_API AMortalCryBenchmarkGameMode : public AMortalCryGameMode
+{
+	GENERATED_BODY()
+
+	/** bots spawned when the url has no Bots option */
+	UPROPERTY(EditDefaultsOnly, Category=Benchmark)
+	int32 DefaultNumBots;
+
+	/** seconds measured when the url has no Duration option */
+	UPROPERTY(EditDefaultsOnly, Category=Benchmark)
+	float DefaultDuration;
+
+	/** seconds ignored before measuring, lets spawning and loading settle */
+	UPROPERTY(EditDefaultsOnly, Category=Benchmark)
+	float DefaultWarmup;
+
+	/** radius of the ring bots are spawned on */
+	UPROPERTY(EditDefaultsOnly, Category=Benchmark)
+	float SpawnRadius;
+
+	/** weapon given to every bot when the url has no Weapon option */
+	UPROPERTY(EditDefaultsOnly, Category=Benchmark)
+	TSubclassOf<ARangedWeapon_Instant> DefaultWeaponClass;
+
+	UPROPERTY(Transient)
+	TArray<AMortalCryCharacter*> Bots;
+
+	UPROPERTY(Transient)
+	TArray<ARangedWeapon_Instant*> BotWeapons;
+
+	TSubclassOf<ARangedWeapon_Instant> WeaponClass;
+	int32 NumBots;
+	float Duration;
+	float Warmup;
+
+	/** time since the bots started firing */
+	float ElapsedTime;
+	bool bMeasuring;
+	bool bFinished;
+
+	/** server frame times over the measured window */
+	TArray<float> FrameTimes;
+
+	/** counters at the start of the measured window */
+	int64 StartShots;
+	uint64 StartTraces;
+	int64 StartBytes;
+
+	void SpawnBots();
+	void StartMeasuring();
+	void FinishBenchmark();
+
+	int64 GetTotalShots() const;
+	uint64 GetTotalTraces() const;
+	int64 GetTotalBytesSent(int32& OutNumClients) const;
+
+public:
+	AMortalCryBenchmarkGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void StartPlay() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	/** average TakeDamage cost of point, radial and generic damage over a number of calls each */
+	UFUNCTION(Exec)
+	void BenchmarkDamage(int32 Iterations = 100000);
+};
@@ -5,9 +5,13 @@
 #include "CoreMinimal.h"
 
 #include "GameFramework/HUD.h"
+#include "Inventory/ItemInfoSubsystem.h"
 
 #include "MortalCryHUD.generated.h"
 
+class AMortalCryCharacter;
+class UUserWidget;
+
 UCLASS()
 class AMortalCryHUD : public AHUD
 {
@@ -21,13 +25,41 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
 	class UTexture2D* CrosshairTex;
 
+	/** crosshair kept on the viewport instead of drawn every frame, the texture is drawn when unset */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<UUserWidget> CrosshairWidgetClass;
+
+	UPROPERTY(Transient)
+	UUserWidget* CrosshairWidget;
+
+	/** informative actor in view, pushed by the character when it changes */
+	UPROPERTY(Transient, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	AActor* FocusedActor;
+
+	TWeakObjectPtr<AMortalCryCharacter> ObservedCharacter;
+	FDelegateHandle NewPawnHandle;
+
+	void HandleNewPawn(APawn* NewPawn);
+
+	UFUNCTION()
+	void HandleInteractFocusChanged(AActor* NewFocus);
+
 protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** the interact prompt should change, widgets update here instead of polling every frame */
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInteractFocusChanged(AActor* NewFocus);
+
+	/** canvas prompt for the focused actor, only called while there is one */
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent)
 	void DrawTextFor(AActor* InteractiveActor);
 
-	UFUNCTION()
-	void TraceForInteractiveActors();
-	
+	/** cached display data of an actor's class, for drawing without calling its interface every frame */
+	UFUNCTION(BlueprintCallable)
+	bool GetItemInfo(AActor* Actor, FCollectedItem& OutItemInfo) const;
+
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent)
 	void DrawCrossHair();
 
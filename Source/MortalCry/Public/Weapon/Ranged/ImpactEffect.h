@@ -6,6 +6,10 @@
 #include "GameFramework/Actor.h"
 #include "ImpactEffect.generated.h"
 
+struct FStreamableHandle;
+class UDecalComponent;
+class USoundCue;
+
 USTRUCT()
 struct FDecalData
 {
@@ -19,7 +23,7 @@ struct FDecalData
 	UPROPERTY(EditDefaultsOnly, Category=Decal)
 	float DecalSize;
 
-	/** lifespan */
+	/** lifespan, zero uses the default of the weapon settings */
 	UPROPERTY(EditDefaultsOnly, Category=Decal)
 	float LifeSpan;
 
@@ -32,7 +36,66 @@ struct FDecalData
 	}
 };
 
-class USoundCue;
+USTRUCT()
+struct FImpactSurfaceData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** surface these effects are played on */
+	UPROPERTY(EditDefaultsOnly, Category=Surface)
+	TEnumAsByte<EPhysicalSurface> SurfaceType;
+
+	UPROPERTY(EditDefaultsOnly, Category=Surface)
+	TSoftObjectPtr<UParticleSystem> FX;
+
+	UPROPERTY(EditDefaultsOnly, Category=Surface)
+	TSoftObjectPtr<USoundCue> Sound;
+
+	/** decal material, the default decal is used when not set */
+	UPROPERTY(EditDefaultsOnly, Category=Surface)
+	TSoftObjectPtr<UMaterial> DecalMaterial;
+
+	/** quad size (width & height) */
+	UPROPERTY(EditDefaultsOnly, Category=Surface)
+	float DecalSize;
+
+	/** lifespan, zero uses the default of the weapon settings */
+	UPROPERTY(EditDefaultsOnly, Category=Surface)
+	float DecalLifeSpan;
+
+	/** defaults */
+	FImpactSurfaceData()
+		: SurfaceType(SurfaceType_Default)
+		, DecalSize(256.f)
+		, DecalLifeSpan(10.f)
+	{
+	}
+};
+
+/** effects resolved for a single surface type */
+struct FImpactSurfaceEffects
+{
+	UParticleSystem* FX;
+	USoundCue* Sound;
+	FDecalData Decal;
+
+	FImpactSurfaceEffects()
+		: FX(nullptr)
+		, Sound(nullptr)
+	{
+	}
+};
+
+/** flat surface type lookup shared by all instances of an impact template, assets are kept loaded by the preload handle */
+struct FImpactSurfaceTable
+{
+	FImpactSurfaceEffects Entries[SurfaceType_Max];
+
+	TSharedPtr<FStreamableHandle> PreloadHandle;
+
+	FORCEINLINE const FImpactSurfaceEffects& Get(EPhysicalSurface SurfaceType) const { return Entries[SurfaceType]; }
+};
+
 UCLASS()
 class MORTALCRY_API AImpactEffect : public AActor
 {
@@ -49,21 +112,53 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category=Defaults)
 	FDecalData DefaultDecal;
 
+	/** material specific overrides, loaded in the background when the template is first preloaded */
+	UPROPERTY(EditDefaultsOnly, Category=Surface)
+	TArray<FImpactSurfaceData> SurfaceOverrides;
+
 	UPROPERTY(BlueprintReadOnly, Category=Surface)
 	FHitResult SurfaceHit;
 
-	/** spawn effect */
-	virtual void PostInitializeComponents() override;
-	
 public:	
 	// Sets default values for this actor's properties
 	AImpactEffect(const FObjectInitializer& ObjectInitializer);
-	
+
+	/** play the effect at a hit, reusing this actor and its decal */
+	void PlayImpact(const FHitResult& Impact);
+
+	/** hide the decal and detach from the surface */
+	void ResetImpact();
+
+	/** is the decal still shown */
+	bool IsPlaying() const;
+
+	/** build the surface lookup of this template and start loading its overrides, call on the class default object */
+	TSharedPtr<FImpactSurfaceTable> CreateSurfaceTable() const;
+
+	/** use a shared surface lookup instead of the defaults */
+	void SetSurfaceTable(const TSharedPtr<const FImpactSurfaceTable>& InSurfaceTable);
+
 protected:
+	/** decal reused for every impact played by this actor */
+	UPROPERTY(VisibleDefaultsOnly, Category=Decal)
+	UDecalComponent* DecalComponent;
+
+	/** handle for hiding the decal after its lifespan */
+	FTimerHandle TimerHandle_ResetImpact;
+
+	/** per surface effects, null until set by the owning pool */
+	TSharedPtr<const FImpactSurfaceTable> SurfaceTable;
+
+	/** fill the table with defaults and whatever overrides are loaded */
+	void ResolveSurfaceTable(FImpactSurfaceTable& Table) const;
+
 	/** get FX for material type */
 	UParticleSystem* GetImpactFX(TEnumAsByte<EPhysicalSurface> SurfaceType) const;
 
 	/** get sound for material type */
 	USoundCue* GetImpactSound(TEnumAsByte<EPhysicalSurface> SurfaceType) const;
 
+	/** get decal for material type */
+	const FDecalData& GetImpactDecal(TEnumAsByte<EPhysicalSurface> SurfaceType) const;
+
 };
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "ImpactEffectSubsystem.generated.h"
+
+class AImpactEffect;
+struct FImpactSurfaceTable;
+
+USTRUCT()
+struct FImpactEffectPool
+{
+	GENERATED_BODY()
+
+	/** instances in activation order, starting at NextIndex */
+	UPROPERTY()
+	TArray<AImpactEffect*> Instances;
+
+	/** least recently used instance, recycled next */
+	int32 NextIndex;
+
+	/** surface lookup shared by every instance */
+	TSharedPtr<FImpactSurfaceTable> SurfaceTable;
+
+	FImpactEffectPool()
+		: NextIndex(0)
+	{
+	}
+};
+
+/**
+ * Per-world pool of impact effect actors, so hits reuse instances instead of spawning one each.
+ */
+UCLASS()
+class MORTALCRY_API UImpactEffectSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FImpactEffectPool> Pools;
+
+	int32 NumSpawnsAvoided;
+
+	/** find the pool of a template, creating it and starting its preload on first use */
+	FImpactEffectPool& GetPool(TSubclassOf<AImpactEffect> Template);
+
+	AImpactEffect* SpawnInstance(TSubclassOf<AImpactEffect> Template, const FImpactEffectPool& Pool) const;
+
+public:
+	UImpactEffectSubsystem();
+
+	/** start loading the per surface effects of a template ahead of its first impact */
+	void PreloadImpact(TSubclassOf<AImpactEffect> Template);
+
+	/** play an impact with a pooled instance of the template */
+	void PlayImpact(TSubclassOf<AImpactEffect> Template, const FHitResult& Impact);
+
+	/** how many actor spawns were saved by reusing pooled instances */
+	FORCEINLINE int32 GetNumSpawnsAvoided() const { return NumSpawnsAvoided; }
+};
@@ -3,14 +3,104 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Curves/CurveFloat.h"
 #include "GameFramework/Actor.h"
+#include "GameFramework/DamageType.h"
 #include "MortalCryProjectile.generated.h"
 
+USTRUCT()
+struct FProjectileWeaponData
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** damage dealt to the actor hit directly */
+	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
+	float HitDamage;
+
+	/** type of damage */
+	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
+	TSubclassOf<UDamageType> DamageType;
+
+	/** multiplier of the hit damage by distance flown, from 0 to FalloffRange, no keys keeps full damage */
+	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
+	FRuntimeFloatCurve DamageFalloff;
+
+	/** distance the damage falloff curve spans */
+	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
+	float FalloffRange;
+
+	/** impulse given to simulating bodies per unit of velocity */
+	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
+	float ImpulseScale;
+
+	/** explosion radius, 0 for a projectile that only damages what it hits */
+	UPROPERTY(EditDefaultsOnly, Category=Explosion)
+	float ExplosionRadius;
+
+	/** damage at the center of the explosion */
+	UPROPERTY(EditDefaultsOnly, Category=Explosion)
+	float ExplosionDamage;
+
+	/** multiplier of the explosion damage by distance from its center, from 0 to 1 of the radius, no keys keeps full damage */
+	UPROPERTY(EditDefaultsOnly, Category=Explosion)
+	FRuntimeFloatCurve ExplosionFalloff;
+
+	/** type of explosion damage */
+	UPROPERTY(EditDefaultsOnly, Category=Explosion)
+	TSubclassOf<UDamageType> ExplosionDamageType;
+
+	/** channel traced from the explosion to each victim, whatever blocks it shields the victim */
+	UPROPERTY(EditDefaultsOnly, Category=Explosion)
+	TEnumAsByte<ECollisionChannel> ExplosionOcclusionChannel;
+
+	/** defaults */
+	FProjectileWeaponData()
+	{
+		HitDamage = 100.f;
+		DamageType = UDamageType::StaticClass();
+		FalloffRange = 5000.f;
+		ImpulseScale = 100.f;
+		ExplosionRadius = 0.f;
+		ExplosionDamage = 100.f;
+		ExplosionDamageType = UDamageType::StaticClass();
+		ExplosionOcclusionChannel = ECC_Visibility;
+	}
+};
+
+/** a falloff curve sampled at even steps, hits read two samples instead of searching the curve keys */
+struct FDamageFalloffTable
+{
+	static constexpr int32 NumSamples = 32;
+
+	TArray<float> Samples;
+	float InputRange;
+
+	FDamageFalloffTable()
+		: InputRange(1.f)
+	{
+	}
+
+	/** an empty curve leaves the table empty, which evaluates to full damage */
+	void Bake(const FRuntimeFloatCurve& Curve, float InInputRange);
+
+	float Evaluate(float Input) const;
+};
+
 UCLASS(config=Game)
 class AMortalCryProjectile : public AActor
 {
 	GENERATED_BODY()
 
+	/** damage config */
+	UPROPERTY(EditDefaultsOnly, Category=Config)
+	FProjectileWeaponData ProjectileConfig;
+
+	FDamageFalloffTable DamageFalloffTable;
+	FDamageFalloffTable ExplosionFalloffTable;
+
+	/** where the current flight started, for the damage falloff */
+	FVector LaunchLocation;
+
 	/** Sphere collision component */
 	UPROPERTY(VisibleDefaultsOnly, Category=Projectile)
 	class USphereComponent* CollisionComp;
@@ -19,9 +109,44 @@ class AMortalCryProjectile : public AActor
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Movement, meta = (AllowPrivateAccess = "true"))
 	class UProjectileMovementComponent* ProjectileMovement;
 
+	/** seconds a fired projectile flies before it goes back to the pool */
+	UPROPERTY(EditDefaultsOnly, Category=Projectile)
+	float ProjectileLifeSpan;
+
+	FTimerHandle TimerHandle_Expire;
+
+	bool bProjectileActive;
+
+	/** spawned by the pool, only those go back to it, anything spawned directly is destroyed, set before BeginPlay */
+	bool bPooled;
+
+	/** launch velocity of the class as configured, in local space when bInitialVelocityInLocalSpace is set */
+	FVector InitialVelocity;
+
+protected:
+	virtual void PostInitializeComponents() override;
+	virtual void BeginPlay() override;
+
+	/** stop, hide and disable collision, leaving the actor to the caller */
+	void StopProjectile();
+
+	/** damage every dynamic object in the explosion radius from one overlap query and one occlusion trace per victim */
+	void ApplyExplosionDamage(const FVector& Origin);
+
 public:
 	AMortalCryProjectile();
 
+	/** fire from a transform with a fresh movement state, used for new and pooled instances alike */
+	void ActivateProjectile(const FVector& Location, const FRotator& Rotation);
+
+	/** stop, hide and hand the projectile back to its pool, or destroy it when the pool did not spawn it */
+	UFUNCTION(BlueprintCallable, Category=Projectile)
+	void DeactivateProjectile();
+
+	FORCEINLINE bool IsProjectileActive() const { return bProjectileActive; }
+
+	FORCEINLINE void SetPooled() { bPooled = true; }
+
 	/** called when projectile hits something */
 	UFUNCTION(BlueprintCallable, BlueprintNativeEvent)
 	void OnHit(UPrimitiveComponent* HitComp, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
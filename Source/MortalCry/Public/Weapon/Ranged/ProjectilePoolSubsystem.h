@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Subsystems/WorldSubsystem.h"
+
+#include "ProjectilePoolSubsystem.generated.h"
+
+class AMortalCryProjectile;
+
+USTRUCT()
+struct FProjectilePool
+{
+	GENERATED_BODY()
+
+	/** deactivated instances ready to be fired again */
+	UPROPERTY()
+	TArray<AMortalCryProjectile*> Inactive;
+
+	/** how many inactive instances are kept, from the weapon settings */
+	int32 MaxInactive;
+
+	FProjectilePool()
+		: MaxInactive(0)
+	{
+	}
+};
+
+/**
+ * Per-world pool of projectile actors, so firing reuses deactivated instances instead of spawning one per shot.
+ */
+UCLASS()
+class MORTALCRY_API UProjectilePoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TMap<UClass*, FProjectilePool> Pools;
+
+	int32 NumSpawnsAvoided;
+
+	FProjectilePool& GetPool(TSubclassOf<AMortalCryProjectile> ProjectileClass);
+
+	/** spawn an inactive pooled instance, owner and instigator are set before it begins play */
+	AMortalCryProjectile* SpawnInstance(TSubclassOf<AMortalCryProjectile> ProjectileClass, const FTransform& SpawnTransform, AActor* Owner, APawn* Instigator) const;
+
+public:
+	UProjectilePoolSubsystem();
+
+	/** spawn inactive instances up to the pool size, so the first volley does not hitch */
+	UFUNCTION(BlueprintCallable, Category = Projectile)
+	void PreallocateProjectiles(TSubclassOf<AMortalCryProjectile> ProjectileClass);
+
+	/** fire a pooled instance of the class, spawning one when the pool is empty */
+	UFUNCTION(BlueprintCallable, Category = Projectile)
+	AMortalCryProjectile* FireProjectile(TSubclassOf<AMortalCryProjectile> ProjectileClass, const FVector& Location, const FRotator& Rotation,
+		AActor* Owner, APawn* Instigator);
+
+	/** fire through the pool of the context's world, what weapons should call instead of spawning projectiles */
+	UFUNCTION(BlueprintCallable, Category = Projectile, meta = (WorldContext = "WorldContextObject"))
+	static AMortalCryProjectile* FirePooledProjectile(const UObject* WorldContextObject, TSubclassOf<AMortalCryProjectile> ProjectileClass,
+		const FVector& Location, const FRotator& Rotation, AActor* Owner, APawn* Instigator);
+
+	UFUNCTION(BlueprintCallable, Category = Projectile, meta = (WorldContext = "WorldContextObject"))
+	static void PreallocatePooledProjectiles(const UObject* WorldContextObject, TSubclassOf<AMortalCryProjectile> ProjectileClass);
+
+	static UProjectilePoolSubsystem* Get(const UObject* WorldContextObject);
+
+	/** take back a deactivated projectile, destroying it when its pool is full */
+	void ReleaseProjectile(AMortalCryProjectile* Projectile);
+
+	/** how many actor spawns were saved by reusing pooled instances */
+	FORCEINLINE int32 GetNumSpawnsAvoided() const { return NumSpawnsAvoided; }
+};
@@ -0,0 +1,175 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "UObject/ObjectKey.h"
+
+#include "ProjectileSimulationSubsystem.generated.h"
+
+class UDamageType;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+/** how a kind of simulated projectile flies, hits and looks */
+USTRUCT(BlueprintType)
+struct FSimulatedProjectileParams
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Projectile)
+	float InitialSpeed;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Projectile)
+	float GravityScale;
+
+	/** radius of the sphere swept along the flight */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Projectile)
+	float Radius;
+
+	/** seconds in flight before the projectile is dropped */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Projectile)
+	float LifeSpan;
+
+	/** the weapon channel hitscan traces on by default, visibility is ignored by pawns */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Projectile)
+	TEnumAsByte<ECollisionChannel> TraceChannel;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Damage)
+	float Damage;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Damage)
+	TSubclassOf<UDamageType> DamageType;
+
+	/** impulse given to simulating bodies per unit of velocity */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Damage)
+	float ImpulseScale;
+
+	/** drawn as one instance per projectile, nothing is drawn without it */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Visual)
+	UStaticMesh* Mesh;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category=Visual)
+	FVector MeshScale;
+
+	FSimulatedProjectileParams()
+		: InitialSpeed(3000.f)
+		, GravityScale(1.f)
+		, Radius(5.f)
+		, LifeSpan(3.f)
+		, TraceChannel(ECC_GameTraceChannel1)
+		, Damage(100.f)
+		, ImpulseScale(100.f)
+		, Mesh(nullptr)
+		, MeshScale(FVector::OneVector)
+	{
+	}
+};
+
+USTRUCT()
+struct FSimulatedProjectileType
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FSimulatedProjectileParams Params;
+
+	/** instances of every projectile of this type, absent on dedicated servers */
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Visuals;
+
+	/** instance transforms built during the visual update */
+	TArray<FTransform> InstanceTransforms;
+
+	FSimulatedProjectileType()
+		: Visuals(nullptr)
+	{
+	}
+};
+
+/**
+ * Simulates projectiles without actors, for weapons that keep many slow bullets in flight.
+ * State is kept as parallel arrays, integrated and swept in one parallel batch per frame, and drawn as instances.
+ * Hits deal point damage on the game thread like AMortalCryProjectile does.
+ * Nothing is replicated. The server fires with damage, and clients replay the weapon's replicated shots
+ * as cosmetic projectiles, the way the instant weapon replays its shot history. Type indices are local to
+ * each machine, shots replicate the type's key and every machine looks up its own index.
+ */
+UCLASS()
+class MORTALCRY_API UProjectileSimulationSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<FSimulatedProjectileType> Types;
+
+	/** index of every keyed type, so a key registered again gets the existing type */
+	TMap<TObjectKey<UObject>, int32> TypesByKey;
+
+	/** owns the instanced visuals */
+	UPROPERTY(Transient)
+	AActor* VisualsHost;
+
+	// one entry per projectile in flight, all arrays share the index
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	TArray<float> RemainingLives;
+	TArray<uint16> TypeIndices;
+	TArray<uint32> IgnoredActorIds;
+	TArray<uint32> IgnoredInstigatorIds;
+	TArray<bool> bCosmetic;
+	TArray<TWeakObjectPtr<AActor>> DamageCausers;
+	TArray<TWeakObjectPtr<AController>> InstigatorControllers;
+
+	// per frame results of the parallel pass
+	TArray<FVector> NextLocations;
+	TArray<FHitResult> Hits;
+	TArray<bool> bBlockingHits;
+
+	bool AddProjectile(int32 TypeIndex, const FVector& Origin, const FVector& Direction, AActor* DamageCauser, AController* InstigatorController, bool bIsCosmetic);
+
+	void Simulate(float DeltaTime);
+	void ApplyHit(int32 Index);
+	void RemoveProjectile(int32 Index);
+	void UpdateVisuals();
+
+	UInstancedStaticMeshComponent* CreateVisuals(const FSimulatedProjectileParams& Params);
+
+public:
+	UProjectileSimulationSubsystem();
+
+	/** below this many projectiles the batch runs on the game thread */
+	static constexpr int32 MinParallelBatchSize = 64;
+
+	/** register a kind of projectile under a stable key like the weapon class or a data asset, returns the index to fire it with,
+	 * registering a key again returns its existing index, a null key always adds a new type */
+	UFUNCTION(BlueprintCallable, Category=Projectile)
+	int32 RegisterProjectileType(const UObject* TypeKey, const FSimulatedProjectileParams& Params);
+
+	/** index of the type registered under a key, INDEX_NONE when there is none */
+	UFUNCTION(BlueprintPure, Category=Projectile)
+	int32 FindProjectileType(const UObject* TypeKey) const;
+
+	/** launch a damaging projectile of a registered type on the server, returns false when the simulation is full */
+	UFUNCTION(BlueprintCallable, Category=Projectile)
+	bool FireProjectile(int32 TypeIndex, const FVector& Origin, const FVector& Direction, AActor* DamageCauser, AController* InstigatorController);
+
+	/** launch a projectile that is only drawn, for clients replaying a shot the server fired */
+	UFUNCTION(BlueprintCallable, Category=Projectile)
+	bool FireCosmeticProjectile(int32 TypeIndex, const FVector& Origin, const FVector& Direction, AActor* DamageCauser);
+
+	FORCEINLINE int32 GetNumProjectiles() const { return Locations.Num(); }
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject
+};
@@ -42,6 +42,10 @@ struct FRangedWeaponData
 	UPROPERTY(EditAnywhere, Category=WeaponStat)
 	float TimeBetweenShots;
 
+	/** most shots fired in a single frame when catching up after a long one, the rest of the backlog is dropped */
+	UPROPERTY(EditAnywhere, Category=WeaponStat, meta=(ClampMin="1"))
+	int32 MaxShotsPerTick;
+
 	/** failsafe reload duration if weapon doesn't have any animation for it */
 	UPROPERTY(EditAnywhere, Category=WeaponStat)
 	float NoAnimReloadDuration;
@@ -56,6 +60,7 @@ struct FRangedWeaponData
     	bInfiniteClip = false;
 		ClipSize = 20;
 		TimeBetweenShots = 0.2f;
+		MaxShotsPerTick = 4;
 		NoAnimReloadDuration = 1.0f;
 	}
 };
@@ -81,11 +86,16 @@ class MORTALCRY_API ARangedWeaponBase : public AWeaponBase, public IRangedWeapon
 	bool bPendingReload;
 
 	int32 BurstCounter;
+
+	/** time owed to the next shot while firing, carried over between frames */
+	float FireTimeAccumulator;
 	
-	FTimerHandle TimerHandle_HandleFiring;
 	FTimerHandle TimerHandle_StopReload;
 	FTimerHandle TimerHandle_ReloadWeapon;
 
+	/** inventory prediction of the owner's reload, acked by the server once it took the ammo, ignored by the owning client's reload checks until the reload ends */
+	int32 ReloadPredictionId;
+
 protected:
 	UPROPERTY(EditDefaultsOnly, Category=Sound)
 	USoundCue* FireLoopSound;
@@ -127,6 +137,17 @@ protected:
 
 	UPROPERTY(Transient)
 	UParticleSystemComponent* MuzzlePSCSecondary;
+
+	/** most pooled effect components this weapon keeps, past it the oldest one is restarted */
+	UPROPERTY(EditDefaultsOnly, Category=Effects, meta=(ClampMin="1"))
+	int32 EffectPoolBudget;
+
+	/** world space effect components owned by this weapon, reactivated instead of spawned */
+	UPROPERTY(Transient)
+	TArray<UParticleSystemComponent*> PooledEffects;
+
+	/** oldest pooled effect, restarted when over budget */
+	int32 NextPooledEffect;
 	
 	UPROPERTY(BlueprintReadOnly, Category = Ranged, meta = (AllowPrivateAccess = "true"))
 	TEnumAsByte<ERangedWeaponState::Type> CurrentState;
@@ -151,25 +172,38 @@ protected:
 	virtual void OnBurstFinished();
 
 	void UseAmmo();
-	void HandleReFiring();
+	/** the shot index is the owning client's burst counter when it fired, in 16 bits */
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerHandleFiring();
+	void ServerHandleFiring(uint16 ShotIndex);
+
+	/** server only, a client shot arrived and is about to be fired on the server too */
+	virtual void RecordServerShot(uint16 ShotIndex) {}
 	virtual void SimulateWeaponFire();
 	void StopSimulatingWeaponFire();
+
+	/** spawn or reactivate an emitter attached to the muzzle, kept around for the next shot */
+	UParticleSystemComponent* ActivateMuzzleFX(UParticleSystemComponent* MuzzleComponent, USkeletalMeshComponent* Mesh) const;
+
+	/** get a free world space effect component from the pool, ready to be placed and activated */
+	UParticleSystemComponent* AcquirePooledEffect(UParticleSystem* Template);
 	void HandleFiring();
 
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerStartReload();
+	void ServerStartReload(int32 PredictionId);
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerStopReload();
 	bool CanReload() const;
 	virtual void StartReload(bool bFromReplication = false);
 	virtual void StopReload();
 	virtual void ReloadWeapon();
+	void AckReloadPrediction();
 	
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	
 public:
+	/** fires every shot that came due this frame while bursting */
+	virtual void Tick(float DeltaSeconds) override;
+
 	virtual void StartFire();
 	virtual void StopFire();
 	
@@ -188,6 +222,12 @@ public:
 	FORCEINLINE bool HasInfiniteAmmo() const { return RangedWeaponConfig.bInfiniteAmmo; }
 	FORCEINLINE bool HasInfiniteClip() const { return RangedWeaponConfig.bInfiniteClip; }
 
+	/** never run dry or reload, for benchmarks and tests */
+	void ForceInfiniteAmmo();
+
+	/** shots fired by this weapon so far, also the index of the next shot */
+	FORCEINLINE int32 GetBurstCounter() const { return BurstCounter; }
+
 	FVector GetAdjustedAim() const;
 	FVector GetMuzzleLocation() const;
 	FVector GetCameraDamageStartLocation(const FVector& AimDir) const;
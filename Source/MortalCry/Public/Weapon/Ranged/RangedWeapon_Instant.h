@@ -4,22 +4,111 @@
 
 #include "CoreMinimal.h"
 #include "Weapon/Ranged/RangedWeaponBase.h"
+#include "Weapon/Ranged/WeaponTraceSubsystem.h"
 #include "RangedWeapon_Instant.generated.h"
 
 class AImpactEffect;
+/** one replicated shot, remote clients replay its trace from their own view of the muzzle */
 USTRUCT()
-struct FInstantHitInfo
+struct FInstantShotInfo
 {
 	GENERATED_USTRUCT_BODY()
 
 	UPROPERTY()
-	FVector Origin;
+	uint16 RandomSeed;
 
+	/** reticle spread in tenths of a degree */
 	UPROPERTY()
-	float ReticleSpread;
+	uint8 QuantizedSpread;
+
+	FInstantShotInfo()
+		: RandomSeed(0)
+		, QuantizedSpread(0)
+	{
+	}
+
+	static uint8 QuantizeSpread(float Spread) { return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Spread * 10.f), 0, static_cast<int32>(MAX_uint8))); }
+	float GetSpread() const { return QuantizedSpread / 10.f; }
+};
+
+/** ring of the most recent shots, only the slots written since the last net update are sent */
+USTRUCT()
+struct FInstantShotHistory
+{
+	GENERATED_USTRUCT_BODY()
 
+	/** must match Size and stay a power of two so the wrapping sequence maps onto the same slots */
 	UPROPERTY()
-	int32 RandomSeed;
+	FInstantShotInfo Shots[8];
+
+	/** number of shots recorded, wraps */
+	UPROPERTY()
+	uint8 Sequence;
+
+	FInstantShotHistory()
+		: Sequence(0)
+	{
+	}
+
+	static constexpr int32 Size = 8;
+
+	void Add(int32 RandomSeed, float ReticleSpread)
+	{
+		FInstantShotInfo& Shot = Shots[Sequence % Size];
+		Shot.RandomSeed = static_cast<uint16>(RandomSeed);
+		Shot.QuantizedSpread = FInstantShotInfo::QuantizeSpread(ReticleSpread);
+		++Sequence;
+	}
+
+	const FInstantShotInfo& Get(uint8 ShotSequence) const { return Shots[ShotSequence % Size]; }
+};
+
+/** compact client hit report, the server regenerates the shot from its index and its own record of the shot */
+USTRUCT()
+struct FInstantHitRecord
+{
+	GENERATED_USTRUCT_BODY()
+
+	/** actor that was hit, null for world geometry and misses */
+	UPROPERTY()
+	AActor* HitActor;
+
+	UPROPERTY()
+	FVector_NetQuantize ImpactPoint;
+
+	UPROPERTY()
+	FVector_NetQuantizeNormal ImpactNormal;
+
+	/** low bits of the shot index, the server extends it from the last shot it accepted */
+	UPROPERTY()
+	uint16 ShotIndex;
+
+	/** milliseconds after the batch timestamp the shot was fired */
+	UPROPERTY()
+	uint8 TimestampOffset;
+
+	UPROPERTY()
+	bool bBlockingHit;
+
+	FInstantHitRecord()
+		: HitActor(nullptr)
+		, ShotIndex(0)
+		, TimestampOffset(0)
+		, bBlockingHit(false)
+	{
+	}
+};
+
+/** where the shooter stood and aimed on the server when a client shot arrived */
+struct FInstantServerShot
+{
+	FVector ViewLocation;
+	FVector AimDir;
+	float ReticleSpread;
+
+	/** low bits of the client shot index, the slot is cleared once a notify used it */
+	uint16 ShotIndex;
+	bool bValid;
 };
 
 USTRUCT()
@@ -55,10 +144,22 @@ struct FInstantWeaponData
 	UPROPERTY(EditDefaultsOnly, Category=WeaponStat)
 	TSubclassOf<UDamageType> DamageType;
 
-	/** hit verification: scale for bounding box of hit actor */
+	/** hit verification: scale for bounding box of hit actor without hitbox history */
 	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
 	float ClientSideHitLeeway;
 
+	/** hit verification: distance the rewound hitbox is grown by to absorb interpolation error */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
+	float HitboxLeeway;
+
+	/** hit verification: distance the reported impact may be from the regenerated shot line */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
+	float ShotPathLeeway;
+
+	/** hit verification: extra leeway off the shot line per unit of distance, for the client aiming slightly ahead of the server */
+	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
+	float ShotPathLeewayPerDistance;
+
 	/** hit verification: threshold for dot product between view direction and hit direction */
 	UPROPERTY(EditDefaultsOnly, Category=HitVerification)
 	float AllowedViewDotHitDir;
@@ -73,7 +174,10 @@ struct FInstantWeaponData
 		WeaponRange = 10000.0f;
 		HitDamage = 50.f;
 		DamageType = UDamageType::StaticClass();
-		ClientSideHitLeeway = 200.0f;
+		ClientSideHitLeeway = 1.5f;
+		HitboxLeeway = 20.0f;
+		ShotPathLeeway = 100.0f;
+		ShotPathLeewayPerDistance = 0.02f;
 		AllowedViewDotHitDir = 0.8f;
 	}
 };
@@ -104,21 +208,85 @@ protected:
 	/** param name for beam target in smoke trail */
 	UPROPERTY(EditDefaultsOnly, Category=Effects)
 	FName TrailTargetParam;
+
+	/** trails of remote players passing further than this from the local view are skipped */
+	UPROPERTY(EditDefaultsOnly, Category=Effects)
+	float TrailCullDistance;
 	
-	UPROPERTY(Transient, ReplicatedUsing=OnRep_HitNotify)
-	FInstantHitInfo HitNotify;
+	UPROPERTY(Transient, ReplicatedUsing=OnRep_ShotHistory)
+	FInstantShotHistory ShotHistory;
+
+	/** sequence of the last replicated shot replayed on this client */
+	uint8 LastSimulatedShot;
+
+	/** per weapon base of the shot seed sequence, picked by the server */
+	UPROPERTY(Transient, Replicated)
+	int32 ShotSeedBase;
+
+	/** server only, index of the last client shot accepted, notifies for older shots are dropped */
+	int32 LastVerifiedShotIndex;
+
+	/** random seed of a shot, both sides derive it from the shot index */
+	int32 GetShotSeed(int32 ShotIndex) const;
+
+	/** direction of a shot spread around the aim */
+	FVector GetShotDirection(const FVector& AimDir, int32 RandomSeed, float ReticleSpread) const;
+
+	/** extend a notified shot index and check it is newer than the last accepted one */
+	bool AcceptShotIndex(uint16 ShotIndexBits, int32& OutShotIndex);
+
+	/** most client shots the server remembers while their hit notify is on the way */
+	static constexpr int32 NumServerShots = 64;
+
+	/** server only, client shots by the low bits of their index */
+	FInstantServerShot ServerShots[NumServerShots];
+
+	virtual void RecordServerShot(uint16 ShotIndex) override;
+
+	/** take the server's record of a notified shot, null if the shot never arrived or was already used */
+	const FInstantServerShot* ConsumeServerShot(uint16 ShotIndexBits);
 
 	float CurrentFiringSpread;
 
+	virtual void BeginPlay() override;
+
+	FCollisionQueryParams GetWeaponTraceParams() const;
+
 	FHitResult WeaponTrace(const FVector& StartTrace, const FVector& EndTrace);
 
-	/** server notified of hit from client to verify */
+	/** queue a trace into the per-frame batch, falls back to an immediate trace without a trace subsystem */
+	void RequestWeaponTrace(const FVector& StartTrace, const FVector& EndTrace, FWeaponTraceDelegate&& OnTraced);
+
+	/** most hits sent to the server in a single notify */
+	static constexpr int32 MaxHitsPerNotify = 16;
+
+	/** hits waiting for the next notify to the server */
+	UPROPERTY(Transient)
+	TArray<FInstantHitRecord> PendingHitRecords;
+
+	/** server time of the first pending hit */
+	float PendingHitsTimestamp;
+
+	FTimerHandle TimerHandle_FlushHitNotifies;
+
+	/** queue a client side hit or miss for the server */
+	void QueueHitNotify(const FHitResult& Impact, int32 ShotIndex);
+
+	/** send every queued hit in one notify */
+	void FlushHitNotifies();
+
+	/** server notified of a batch of client hits and misses to verify */
 	UFUNCTION(reliable, server, WithValidation)
-	void ServerNotifyHit(const FHitResult& Impact, FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread);
+	void ServerNotifyHits(const TArray<FInstantHitRecord>& Hits, float BaseTimestamp);
+
+	/** rebuild the hit from a client record */
+	FHitResult RebuildHitResult(const FInstantHitRecord& Record, const FVector& Origin, const FVector& ShootDir) const;
 
-	/** server notified of miss to show trail FX */
-	UFUNCTION(unreliable, server, WithValidation)
-	void ServerNotifyMiss(FVector_NetQuantizeNormal ShootDir, int32 RandomSeed, float ReticleSpread);
+	/** verify a hit reported by the client, rays start from where the server saw the shooter when the shot arrived */
+	void VerifyClientHit(const FHitResult& Impact, const FInstantServerShot& Shot, const FVector& ShootDir, int32 RandomSeed, float ClientTimestamp);
+
+	/** client reported a miss, show trail FX */
+	void ProcessClientMiss(const FVector& ShootDir, int32 RandomSeed, float ReticleSpread);
 
 	void ProcessInstantHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread);
 
@@ -126,20 +294,29 @@ protected:
 
 	void DealDamage(const FHitResult& Impact, const FVector& ShootDir);
 	
-	void ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread);
+	void ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 ShotIndex, float ReticleSpread);
 	virtual void Fire() override;
 
+	/** batched trace of a fired shot is resolved */
+	void OnFireTraced(const FHitResult& Impact, FVector Origin, FVector ShootDir, int32 ShotIndex, float ReticleSpread);
+
 	/** called in network play to do the cosmetic fx  */
 	void SimulateInstantHit(const FVector& Origin, int32 RandomSeed, float ReticleSpread);
 
+	/** batched trace of a simulated shot is resolved */
+	void OnSimulatedTraced(const FHitResult& Impact, FVector EndTrace);
+
 	/** spawn effects for impact */
 	void SpawnImpactEffects(const FHitResult& Impact);
 
 	/** spawn trail effect */
 	void SpawnTrailEffect(const FVector& EndPoint);
+
+	/** is a remote player's trail too far from the local view to be worth showing */
+	bool ShouldCullTrail(const FVector& Origin, const FVector& EndPoint) const;
 	
 	UFUNCTION()
-	void OnRep_HitNotify();
+	void OnRep_ShotHistory();
 	
 	virtual void OnBurstFinished() override;
 };
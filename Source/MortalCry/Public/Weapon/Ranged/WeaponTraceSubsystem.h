@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+
+#include "WeaponTraceSubsystem.generated.h"
+
+DECLARE_DELEGATE_OneParam(FWeaponTraceDelegate, const FHitResult& /*Impact*/);
+
+struct FWeaponTraceRequest
+{
+	FVector Start;
+	FVector End;
+	TEnumAsByte<ECollisionChannel> TraceChannel;
+	FCollisionQueryParams Params;
+
+	/** called on the game thread once the trace is resolved */
+	FWeaponTraceDelegate OnTraced;
+};
+
+/**
+ * Collects every hitscan trace requested during a frame and resolves them in one parallel batch.
+ * Results are delivered on the game thread in the order the requests were made.
+ */
+UCLASS()
+class MORTALCRY_API UWeaponTraceSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+	TArray<FWeaponTraceRequest> PendingRequests;
+	TArray<FWeaponTraceRequest> InFlightRequests;
+	TArray<FHitResult> Results;
+
+	bool bFlushing;
+
+	/** traces resolved since the world started */
+	uint64 NumTracesFlushed;
+
+public:
+	UWeaponTraceSubsystem();
+
+	/** below this many requests the batch is traced on the game thread */
+	static constexpr int32 MinParallelBatchSize = 4;
+
+	/** queue a line trace, resolved at the end of the frame */
+	void RequestTrace(const FVector& Start, const FVector& End, ECollisionChannel TraceChannel,
+					const FCollisionQueryParams& Params, FWeaponTraceDelegate&& OnTraced);
+
+	/** resolve everything queued so far */
+	void Flush();
+
+	FORCEINLINE int32 GetNumPendingTraces() const { return PendingRequests.Num(); }
+
+	FORCEINLINE uint64 GetNumTracesFlushed() const { return NumTracesFlushed; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	/** queued shots resolve once play resumes, along with the weapons that fired them */
+	virtual bool IsTickableWhenPaused() const override { return false; }
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+	virtual TStatId GetStatId() const override;
+	// End of FTickableGameObject
+};
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "Engine/DeveloperSettings.h"
+
+#include "WeaponSettings.generated.h"
+
+class AMortalCryProjectile;
+
+/**
+ *
+ */
+UCLASS(Config = Game, DefaultConfig)
+class MORTALCRY_API UWeaponSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	/** impact effects kept alive per template in a world, past it the least recently used one is recycled */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Effects", meta = (ClampMin = "1"))
+	int32 ImpactEffectPoolSize;
+
+	/** seconds a pooled impact decal stays up when its template sets no lifespan, then the instance goes back to the pool */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Effects", meta = (ClampMin = "0.1"))
+	float DefaultImpactDecalLifeSpan;
+
+	/** inactive projectiles kept per class in a world for classes without their own size, more are destroyed on release */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Projectiles", meta = (ClampMin = "0"))
+	int32 DefaultProjectilePoolSize;
+
+	/** pool sizes of projectile classes fired in bulk, like rockets or grenades */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Projectiles")
+	TMap<TSoftClassPtr<AMortalCryProjectile>, int32> ProjectilePoolSizes;
+
+	/** simulated projectiles in flight per world, further shots are dropped */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Config, Category = "Projectiles", meta = (ClampMin = "1"))
+	int32 MaxSimulatedProjectiles;
+
+	explicit UWeaponSettings(const FObjectInitializer& ObjectInitializer);
+
+	static const UWeaponSettings* Get();
+
+	int32 GetProjectilePoolSize(TSubclassOf<AMortalCryProjectile> ProjectileClass) const;
+};
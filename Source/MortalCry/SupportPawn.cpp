@@ -3,6 +3,7 @@
 
 #include "SupportPawn.h"
 
+#include "GameplayInterfaceCache.h"
 #include "Possessive.h"
 #include "GameFramework/FloatingPawnMovement.h"
 #include "Kismet/KismetSystemLibrary.h"
@@ -88,7 +89,7 @@ AActor* ASupportPawn::Trace_Implementation()
 	{
 		if ( APawn* HPawn = Cast<APawn>(OutHit.Actor) )
 		{
-			if ( !HPawn->IsPlayerControlled() && HPawn->Implements<UPossessive>() && IPossessive::Execute_IsPossessive(HPawn) )
+			if ( !HPawn->IsPlayerControlled() && FGameplayInterfaceCache::Implements(HPawn->GetClass(), EGameplayInterface::Possessive) && IPossessive::Execute_IsPossessive(HPawn) )
 			{
 				return HPawn;
 			}